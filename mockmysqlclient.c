@@ -0,0 +1,191 @@
+/*
+  mockmysqlclient.c --  A stand-in for MySQL or MariaDB Connector C, for testing and benchmarking pgoptionfiles
+
+   Version: 1.0.0
+   Last modified: October 16 2026
+*/
+/*
+  Copyright (c) 2025 by Peter Gulutzan. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; version 2 of the License.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/*
+  WHY IT IS GOOD
+    Testing or benchmarking pgoptionfiles should not require a real Connector C library to be installed,
+    and real option files are few and small. This library has the functions that pgoptionfiles calls and
+    does option-file accesses the way a real connector does, but what it accesses is configurable.
+  HOW TO BUILD IT
+    gcc -shared -fPIC -o libmockmysqlclient.so mockmysqlclient.c
+    (pgoptionfiles_bench.sh does this.)
+  WHAT IT DOES
+    mysql_init(), mysql_options(), mysql_close() do nothing much.
+    mysql_get_client_info() returns $PGOPTIONFILES_MOCK_VERSION or "0.0.0-mock".
+    mysql_real_connect() looks for these option files, in this order, then fails:
+      if mysql_options(MYSQL_READ_DEFAULT_FILE) happened: only that file
+      otherwise:
+        /etc/my.cnf, /etc/mysql/my.cnf
+        $PGOPTIONFILES_MOCK_ROOT/my.cnf                        if PGOPTIONFILES_MOCK_ROOT is set, like MYSQL_HOME
+        /nonexistent-pgoptionfiles-mock/1.cnf ... /N.cnf     if PGOPTIONFILES_MOCK_FILES=N is set
+        $HOME/.my.cnf
+    Looking means access(), then if access() succeeded fopen() and read it. So with a default pgoptionfiles build
+    every file seems not to exist, but with -DPGOPTIONFILES_READ=1 the files are read, and lines
+      !include file-name
+      !includedir directory-name
+    cause more accesses, as in a real connector. !includedir reads *.cnf in directory-name in name order.
+    Nesting is limited to PGOPTIONFILES_MOCK_MAX_DEPTH levels.
+    So a corpus made by pgoptionfiles_bench.sh, with deep !includedir trees and thousands of files,
+    is as much work for pgoptionfiles as it would be with a real connector.
+*/
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PGOPTIONFILES_MOCK_MAX_DEPTH 64
+
+typedef struct MYSQL {
+  char opaque_item[4096];
+  char default_file[PATH_MAX];
+} MYSQL;
+
+static void mock_read_option_file(const char *file_name, int depth);
+
+MYSQL *mysql_init(MYSQL *mysql)
+{
+  if (mysql == NULL) mysql= calloc(1, sizeof(MYSQL));
+  else memset(mysql, 0, sizeof(MYSQL));
+  return mysql;
+}
+
+const char *mysql_get_client_info(void)
+{
+  const char *version= getenv("PGOPTIONFILES_MOCK_VERSION");
+  if (version == NULL) version= "0.0.0-mock";
+  return version;
+}
+
+/* Only MYSQL_READ_DEFAULT_FILE (4) matters, MYSQL_READ_DEFAULT_GROUP (5) and others are accepted and ignored */
+int mysql_options(MYSQL *mysql, int option, const void *arg)
+{
+  if ((option == 4) && (arg != NULL))
+    snprintf(mysql->default_file, sizeof(mysql->default_file), "%s", (const char *) arg);
+  return 0;
+}
+
+MYSQL *mysql_real_connect(MYSQL *mysql, const char *host, const char *user, const char *passwd,
+                          const char *db, unsigned int port, const char *unix_socket, unsigned long client_flag)
+{
+  char file_name[PATH_MAX];
+  (void) host; (void) user; (void) passwd; (void) db; (void) port; (void) unix_socket; (void) client_flag;
+  if (mysql->default_file[0] != '\0')
+  {
+    mock_read_option_file(mysql->default_file, 0);
+    return NULL;
+  }
+  mock_read_option_file("/etc/my.cnf", 0);
+  mock_read_option_file("/etc/mysql/my.cnf", 0);
+  const char *root= getenv("PGOPTIONFILES_MOCK_ROOT");
+  if (root != NULL)
+  {
+    snprintf(file_name, sizeof(file_name), "%s/my.cnf", root);
+    mock_read_option_file(file_name, 0);
+  }
+  const char *files= getenv("PGOPTIONFILES_MOCK_FILES");
+  if (files != NULL)
+  {
+    long count= atol(files);
+    for (long i= 1; i <= count; ++i)
+    {
+      snprintf(file_name, sizeof(file_name), "/nonexistent-pgoptionfiles-mock/%ld.cnf", i);
+      mock_read_option_file(file_name, 0);
+    }
+  }
+  const char *home= getenv("HOME");
+  if (home != NULL)
+  {
+    snprintf(file_name, sizeof(file_name), "%s/.my.cnf", home);
+    mock_read_option_file(file_name, 0);
+  }
+  return NULL; /* no server, so the connect fails, as it does for pgoptionfiles with a real connector */
+}
+
+void mysql_close(MYSQL *mysql)
+{
+  (void) mysql; /* pgoptionfiles passes what mysql_init() returned, but it might be a caller's struct so don't free */
+}
+
+static int mock_compare(const void *a, const void *b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static void mock_read_option_directory(const char *directory_name, int depth)
+{
+  DIR *dir= opendir(directory_name);
+  if (dir == NULL) return;
+  char **names= NULL;
+  size_t count= 0, allocated= 0;
+  struct dirent *entry;
+  while ((entry= readdir(dir)) != NULL)
+  {
+    size_t length= strlen(entry->d_name);
+    if ((length <= 4) || (strcmp(entry->d_name + length - 4, ".cnf") != 0)) continue;
+    if (count == allocated)
+    {
+      allocated= (allocated == 0) ? 64 : allocated * 2;
+      char **new_names= realloc(names, allocated * sizeof(char *));
+      if (new_names == NULL) break;
+      names= new_names;
+    }
+    names[count++]= strdup(entry->d_name);
+  }
+  closedir(dir);
+  qsort(names, count, sizeof(char *), mock_compare);
+  for (size_t i= 0; i < count; ++i)
+  {
+    char file_name[PATH_MAX];
+    /* a name too long for a path is skipped */
+    if (strlen(directory_name) + 1 + strlen(names[i]) < sizeof(file_name))
+    {
+      strcpy(file_name, directory_name);
+      strcat(file_name, "/");
+      strcat(file_name, names[i]);
+      mock_read_option_file(file_name, depth + 1);
+    }
+    free(names[i]);
+  }
+  free(names);
+}
+
+static void mock_read_option_file(const char *file_name, int depth)
+{
+  if (depth > PGOPTIONFILES_MOCK_MAX_DEPTH) return;
+  if (access(file_name, R_OK) != 0) return;
+  FILE *fp= fopen(file_name, "r");
+  if (fp == NULL) return;
+  char line[PATH_MAX + 64];
+  while (fgets(line, sizeof(line), fp) != NULL)
+  {
+    line[strcspn(line, "\r\n")]= '\0';
+    if (strncmp(line, "!includedir ", sizeof("!includedir ") - 1) == 0)
+      mock_read_option_directory(line + sizeof("!includedir ") - 1, depth + 1);
+    else if (strncmp(line, "!include ", sizeof("!include ") - 1) == 0)
+      mock_read_option_file(line + sizeof("!include ") - 1, depth + 1);
+  }
+  fclose(fp);
+}
@@ -33,17 +33,22 @@
     So, tell this program what the Connector C library is, and it will tell you what option files the connector uses.
   HOW IT WORKS
     With ptrace().
-    It opens the Connector C library and calls mysql_options() + mysql_real_connect() so the library reads the option files.
+    The tracer starts the tracee (pgoptionfiles_tracee, or a fork() if that program isn't there).
+    The tracee opens the Connector C library and calls mysql_init() untraced, so the thousands of syscalls of
+    dynamic loading cost nothing extra, then says it's ready on a socketpair and waits until the tracer has done
+    PTRACE_SEIZE with PTRACE_O_EXITKILL, so there is no PTRACE_TRACEME + raise(SIGSTOP) handshake and the tracee
+    can't outlive the tracer. Then it calls mysql_options() + mysql_real_connect() so the library reads the option files.
     (The mysql_real_connect() call is harmless, it is designed to fail.)
     The libraries are opening files with syscalls. It's possible to catch the arguments of the syscalls and filter the
     ones that contain "*my.cnf".
     Then pgoptionfiles outputs a list:
       (pgoptionfiles)(Connector C version ...)
-      etc/my.cnf
+      /etc/my.cnf
       /etc/mysql/my.cnf
-      /etc/mysql/conf.d//my.cnf
-      /etc/mysql/mariadb.conf.d//my.cnf
+      /etc/mysql/conf.d/my.cnf
+      /etc/mysql/mariadb.conf.d/my.cnf
       /home/pgulutzan/.my.cnf
+    File names are absolute and normalized (no // or /./, and /../ only as the connector passed it), see CANONICAL PATHS.
     The list includes default option files which the connector opened, i.e. syscall(filename) succeeded.
     The list includes files which the connector would have opened but couldn't, i.e. access(filename) failed.
     The list includes files which were !included in other files if and only if a non-default build option is used.
@@ -52,15 +57,19 @@
   HOW TO BUILD IT
     You need post-2019 Linux, gcc, pgoptionfiles.c (this file), and pgoptionfiles.h.
     Ensure that the libdl library is accessible with an "-ldl" clause because there will be a dlopen() call.
+    Before glibc 2.34 add -lpthread as well, for PGOPTIONFILES_PREFETCH's thread.
     gcc -o pgoptionfiles pgoptionfiles.c -ldl
+    Optionally, and recommended, also build the tracee program from the same source, in the same directory:
+    gcc -DPGOPTIONFILES_TRACEE_PROGRAM=1 -o pgoptionfiles_tracee pgoptionfiles.c -ldl
   HOW TO USE IT
     You just need to know library name = path of the Connector C library, whose name usually ends with ".so".
     You may find that pgfindlib https://github.com/pgulutzan/pgfindlib is useful for finding the library name.
-    pgoptionfiles library-name
+    pgoptionfiles [options] library-name
     ... Result will be either an error message or a list of the option files that the connector read or tried to read
+    Options are described after the build options, below.
   WHAT IT CALLS
     The library functions are mysql_init(), mysql_options(...MYSQL_READ_DEFAULT_GROUP ...),
-    mysql_real_connect(... NULL ...), mysql_close().
+    mysql_real_connect(... NULL ...), mysql_close(). With --query also mysql_options(...MYSQL_READ_DEFAULT_FILE ...).
   HOW IT CAN FAIL
     It can fail if for security ptrace() is disabled or limited for your system or for your privilege set.
     https://becomingahacker.org/a-comparative-overview-of-selinux-apparmor-yama-tomoyo-linux-and-smack-bf7f0a1789cf
@@ -76,12 +85,13 @@
       at some point during handshake ..."). If MySQL or MariaDB changes this behaviour or if a custom plugin
       activates early, pgoptionfiles could fail.
   PGOPTIONFILES_DELIMITER
-    In the output list the default delimiter is \n, which is why file names are printed on separate lines.
-    To change it to comma or colon or semicolon etc., compile with
-    -DPGOPTIONFILES_DELIMITER="','" or -DPGOPTIONFILES_DELIMITER="':'" or -DPGOPTIONFILES_DELIMITER="';'" etc.
+    In the output list (with the default --format newline) the default delimiter is \n, which is why file names are printed on separate lines.
+    To change it to comma or colon or semicolon etc., say --delimiter , or --delimiter : etc., or to change the
+    default, compile with -DPGOPTIONFILES_DELIMITER="','" or -DPGOPTIONFILES_DELIMITER="':'" etc.
   PGOPTIONFILES_READ
     Default behaviour is that pgoptionfiles does not allow the connector to read the files.
-    To change it, compile with -DPGOPTIONFILES_READ=1. The benefit is that the connector will see "!include ..."
+    To change it, say --read, or to change the default, compile with -DPGOPTIONFILES_READ=1 (then --no-read is
+    the way back). The benefit is that the connector will see "!include ..."
     instructions and open those !included files too, therefore file_name_list will have not only the default
     option files but every file. The possible non-benefits are: MySQL Connector C will display error messages
     if e.g. !include file does not exist (before the first line that pgoptionfiles displays starting with "(pgoptionfiles)"),
@@ -96,12 +106,216 @@
       for MariaDB 3.4.3: export C_INCLUDE_PATH=/home/pgulutzan/connector-c-3.4.3/usr/local/include/mariadb
     then say
     gcc -DPGOPTIONFILES_INCLUDE_MYSQL=1 -o pgoptionfiles pgoptionfiles.c -ldl
+  PGOPTIONFILES_PREFETCH
+    On (1) by default. The first run after boot is slow because dlopen() has to read the connector and the
+    libraries it needs (libssl, libcrypto, libz ...) from disk one after another. So, just before the tracee is
+    started, a thread in the tracer's process reads the connector's ELF dynamic section, finds its DT_NEEDED libraries
+    and theirs the way ld.so would, and does posix_fadvise(POSIX_FADV_WILLNEED) on each file as soon as it's found,
+    so the disk reads happen at the same time and before dlopen() wants them, while the tracer goes straight on to
+    seize the tracee. It's only a hint, nothing fails if it can't. Not with --root or --placement.
+    To turn it off, compile with -DPGOPTIONFILES_PREFETCH=0. See the PREFETCH section.
   PGOPTIONFILES_TRACEE_ONLY
     This is a debugging option, off (0) by default. If it is on (1), there is no ptrace() and no tracer.
-    An example test case: build with -DPGOPTIONFILES_TRACEE_ONLY=1 -DPGOPTIONFILES_READ=1,
-    strace 2>&1 ./pgoptionfiles library-name | grep my.cnf
-    to check whether it displays the same file names.
+    A normal build does the same with --tracee-only, without the smaller binary. An example test case:
+    strace 2>&1 ./pgoptionfiles --tracee-only library-name | grep my.cnf
+    to check whether it displays the same file names as ./pgoptionfiles --read library-name.
+  PGOPTIONFILES_USE_TIMEOUT
+    Off (0) by default, i.e. the tracer waits for the tracee as long as it takes. --timeout (or compiling with
+    -DPGOPTIONFILES_USE_TIMEOUT=1 to make that the default, then --no-timeout is the way back) makes the tracer
+    poll waitpid() with growing sleeps and kill the tracee if it's unresponsive for a few seconds.
+    --read and --timeout don't cost a branch per syscall stop: the tracer loop is compiled once for each
+    combination and pgoptionfiles_tracer() picks one at the start.
+  PGOPTIONFILES_USDT
+    On (1) by default if <sys/sdt.h> exists (e.g. the systemtap-sdt-dev package), else off (0). With it the tracer
+    has USDT (SystemTap / DTrace style) static probes, which are a nop instruction each until something attaches,
+    so production binaries can keep them. Provider pgoptionfiles, probes and arguments:
+      syscall_entry    pid, syscall number                 at each syscall-entry stop (ptrace tracer and --pid)
+      classify         pid, syscall number, arg number     after pgoptionfiles_tracer_arg_number(), -1 = not relevant
+      copy_start       pid, tracee address                 before pgoptionfiles_copy_from_tracee() peeks
+      copy_done        pid, length                         after it
+      dedup            file name, entry number             -1 = duplicate, >= 0 = new, < -1 = list overflow
+      phase            old phase, new phase                PGOPTIONFILES_PHASE_... numbers, at each tracee phase marker
+    For example, a histogram of file name copy times:
+      bpftrace -e 'usdt:./pgoptionfiles:pgoptionfiles:copy_start { @s[tid]= nsecs; }
+                   usdt:./pgoptionfiles:pgoptionfiles:copy_done /@s[tid]/ { @ns= hist(nsecs - @s[tid]); delete(@s[tid]); }'
+    or perf probe -x ./pgoptionfiles sdt_pgoptionfiles:dedup then perf record -e sdt_pgoptionfiles:dedup.
+    To leave them out anyway, compile with -DPGOPTIONFILES_USDT=0.
+  PGOPTIONFILES_LIBRARY
+    Off (0) by default. If it is on (1), there is no main(), so pgoptionfiles.c can be compiled into another program,
+    which #includes pgoptionfiles.h and calls pgoptionfiles_run() or the non-blocking pgoptionfiles_async_...()
+    functions (see the ASYNC section), e.g. gcc -DPGOPTIONFILES_LIBRARY=1 -c pgoptionfiles.c
+    --pid is not possible in such a build, see the ATTACH section.
+  PGOPTIONFILES_TRACEE_PROGRAM
+    Off (0) by default. If it is on (1), the build is pgoptionfiles_tracee, which is only the tracee code.
+    If pgoptionfiles finds pgoptionfiles_tracee in its own directory, it starts it with posix_spawn() (which
+    is vfork-like, the tracer's memory isn't copied) instead of fork(), passing the sync pipe and the
+    library name, --root DIR and --query items as arguments. The tracee is then a small fresh process with its own
+    small stack and no tracer pages, and the O0 code-generation rules for the tracee apply only there.
+    Its own start-up (exec, ld.so) is over before the tracer seizes it, so none of that is traced: ordinarily
+    the tracer waits for the "ready" byte after the library load anyway, and with --profile, which traces the load,
+    pgoptionfiles_tracee first sends a start-up byte and the tracer waits for that before it seizes.
+    Only the sync pipe is passed on, the tracer's other file descriptors are closed in pgoptionfiles_tracee
+    (glibc 2.34+, posix_spawn_file_actions_addclosefrom_np()), so e.g. --diff or --scan workers' pipes stay private.
+    pgoptionfiles_bench.sh builds it next to pgoptionfiles.
+    It's dynamically linked, because a static program can't safely dlopen() a Connector C that needs the host's libc.
+    If pgoptionfiles_tracee isn't there, or posix_spawn() fails, the tracee is a fork() as before.
+    --backend seccomp always uses fork(), its tracee installs the filter before the library is loaded.
+  --record FILE
+    Write every classified syscall stop, i.e. every syscall that pgoptionfiles_tracer_arg_number() accepts,
+    to FILE as well as doing the usual output. Each record has syscall number, file name, return value,
+    and nanoseconds since the trace started. Return value is -ENOSYS if the trace ended before the syscall did.
+    The format (see struct pgoptionfiles_record in pgoptionfiles.h) is append-only and buffered, so it's cheap.
+  --replay FILE
+    Instead of tracing a library, read FILE which was made by --record and do the filtering, duplicate
+    elimination, and output as if the syscalls were happening now. There is no tracee so no library-name.
+    For example record on a production host, then replay elsewhere, or benchmark everything except ptrace().
+      pgoptionfiles --record /tmp/trace.bin library-name
+      pgoptionfiles --replay /tmp/trace.bin
+    Filtering depends on --read, so replay with the same --read or --no-read that the recorder had.
+  --diff library-a library-b
+    Trace two Connector C libraries at the same time (each in its own worker process, same environment),
+    then instead of the usual output show how b differs from a, e.g. when upgrading a to b:
+      (pgoptionfiles)(diff)
+      a /home/pgulutzan/connector-c-3.4.3/usr/local/lib/mariadb/libmariadb.so (Connector C version 3.4.3)
+      b /home/pgulutzan/mysql-8.3.0-linux-glibc2.28-x86_64/lib/libmysqlclient.so (Connector C version 8.3.0)
+      added /usr/local/mysql/etc/my.cnf
+      added /home/pgulutzan/.mylogin.cnf
+    Other possible lines are "removed file-name" and "reordered file-name position-in-a position-in-b".
+    Return code is 0 if no difference, 1 if difference, or negative if either trace failed.
+  --metrics json or --metrics prometheus
+    After the trace, print to stderr what the tracer did and how long it took: syscall stops, classified stops
+    (the ones with a relevant file name), PTRACE_PEEKDATA calls and bytes, duplicate file names ignored,
+    time blocked in waitpid(), and time in each tracee phase (load = dlopen + dlsym + mysql_init, options,
+    connect, close). load is untraced unless --profile, so it has no stops, only the time until the tracee was ready. json is one object on one line, prometheus is text exposition format with a library label.
+    With --replay the times come from the --record timestamps and ptrace-only counters are 0.
+  --profile
+    Keep every syscall the tracee makes, not just the ones with option-file names, and after the trace print
+    to stderr, for each phase, a histogram of syscall name, count, total time and mean time between syscall entry
+    and exit, busiest first, then the PGOPTIONFILES_PROFILE_SLOWEST slowest single syscalls with the file name or,
+    for connect(), the address (port 53 is marked DNS). So it shows where Connector C startup time goes, e.g. into
+    reading libssl + libcrypto + certificate files during load, or into name lookups during connect.
+    Times include the tracer's own stop overhead, which is about the same for every syscall, so compare counts
+    and relative times rather than trusting small absolute numbers. Not with --replay or --backend seccomp.
+  --perf-counters
+    After the trace, print to stderr a table of perf_event counters per phase, for the tracer and the tracee:
+    task-clock milliseconds, context switches, CPU migrations, page faults, and where the CPU has them (not in
+    many VMs) cycles and instructions, next to each phase's wall-clock milliseconds. No privileges are needed beyond
+    what perf_event_paranoid allows for your own processes; if kernel counting isn't allowed the counts are for user
+    space only, and the table says so. The tracee's counters are for its main thread. See the PERF COUNTERS section.
+  --placement same|siblings|spread[,CPU] and --sched other|batch|idle|fifo|rr
+    Each syscall stop is two wakeups, tracee to tracer and back, so where the two run matters. same pins both to
+    one CPU, siblings puts the tracee on the other hardware thread of the tracer's core (or another core of the
+    same package), spread puts it on another core. CPU is the tracer's CPU, default the one it's on when the trace
+    starts. --sched sets the scheduling policy of both, fifo and rr need CAP_SYS_NICE or ulimit -r. Default is
+    to leave both alone, which is also --placement none. Not with --diff or --scan or more than one --root DIR.
+  --compare-placement
+    Instead of the usual output, trace library-name PGOPTIONFILES_COMPARE_RUNS (20) times with each of
+    --placement none, same, siblings, spread, and print a table of median and minimum nanoseconds per syscall stop
+    for each, then which was best. With --sched it's the same policy for every run. Not with --timeout, whose
+    waitpid(WNOHANG) and usleep() loop would be what's timed. See the PLACEMENT section.
+      pgoptionfiles --compare-placement --sched fifo library-name
+  --coalesce
+    For when many programs on a host start at once and each asks the same question, e.g. ocelotgui instances or
+    audit agents after a reboot. Same question means same library, --read, --query, --root, --backend, user,
+    current directory and connector-related environment (HOME, MYSQL_*, MARIADB_*, LD_* ...). The first caller
+    traces, the others wait on a lock file in PGOPTIONFILES_COALESCE_DIRECTORY (/tmp) and then take its answer
+    from a result file, so N callers cost one trace, even if it failed. An answer is only taken if it was
+    written after the caller started, so it's never older than the caller, and each caller still does its own
+    --format, --verify and output. Also with --diff, --scan and --root DIR:DIR..., where each library is a
+    question. Not with --pid, --replay, --record, --metrics, --profile, --perf-counters. See the COALESCE section.
+  --verify
+    After the trace, statx() every listed file and its directory, and add to --format json or csv output whether
+    each exists, its size and mtime (seconds since the epoch), and whether its directory exists. This is what the
+    file system says now, which for --format json or csv may differ from status, e.g. status is denied but the file exists.
+    All the statx() calls are submitted as one io_uring batch (Linux 5.6+), so on slow network or overlay file systems
+    the latency is paid once rather than once per path. If io_uring isn't available, plain statx() calls.
+    With --root the paths are resolved inside DIR, as the chrooted tracee saw them, e.g. an absolute symlink in the
+    image points into the image. Only with --format json or csv, the others have nowhere to put it. See the VERIFY section.
+  --format newline or --format nul or --format json or --format csv or --format stream
+    newline is the default, described above, with file names separated by --delimiter, default PGOPTIONFILES_DELIMITER.
+    nul is the "(pgoptionfiles)..." line and then each file name, each followed by '\0', like find -print0.
+    json is {"pgoptionfiles":"(pgoptionfiles)...","retcode":0,"files":[{"name":"/etc/my.cnf","status":"denied"},...]}
+    csv is a name,status header, a "(pgoptionfiles)...",message row (error instead of message if failure),
+    then a file-name,status row for each file.
+    status is denied (without --read the syscall is made to fail), ok, unknown, or an errno name such as ENOENT.
+    Output is with one writev() directly from the list, there's no intermediate string.
+    stream isn't for people, it's what pgoptionfiles_async_start() reads, see the ASYNC section.
+  --watch
+    After the usual output, don't exit. Use inotify to watch the listed files, their directories, and the library.
+    When a listed file is created, deleted or modified, output e.g. "(pgoptionfiles)(watch)created /etc/my.cnf".
+    When the library changes, trace again and output everything again. So a caller such as ocelotgui can keep
+    the pipe open and always have a current answer without paying for a trace each time. See the WATCH section.
+  --query GROUP or --query GROUP,FILE
+    May be repeated, up to PGOPTIONFILES_MAX_QUERIES times. Default is as if --query client.
+    For each query the tracee does mysql_init(), mysql_options(MYSQL_READ_DEFAULT_GROUP, GROUP),
+    if FILE then mysql_options(MYSQL_READ_DEFAULT_FILE, FILE), mysql_real_connect(), mysql_close(),
+    all in the same tracee, so dlopen() and tracer setup happen once however many queries there are.
+    Output has each query's files after a line "(pgoptionfiles)(query GROUP[,FILE])", duplicates are
+    eliminated within a query but not across queries. Not with --diff.
+      pgoptionfiles --query client --query mysqldump,/etc/backup.cnf library-name
+  --root DIR or --root DIR:DIR...
+    DIR is the root of an unpacked container image, e.g. made with docker export or umoci unpack, and library-name
+    is the connector's path in the image. After the tracer has it, the tracee does unshare() for a new user namespace
+    (where it's uid 0) and mount namespace, then chroot(DIR), and sets HOME to root's home in DIR/etc/passwd.
+    So the connector sees the image's /etc and HOME and the file names are as they are in the image.
+    It needs unprivileged user namespaces (sysctl kernel.unprivileged_userns_clone=1 on some distros), not a container runtime.
+    Other environment variables e.g. MYSQL_HOME are unchanged, and the connector uses this host's libc, which is
+    already loaded. With more than one DIR, each is traced by a worker, at most PGOPTIONFILES_MAX_WORKERS or
+    number-of-CPUs at once, and each output starts "(pgoptionfiles)(root DIR)", in the order the workers end.
+      pgoptionfiles --root /images/web:/images/batch /usr/lib/x86_64-linux-gnu/libmariadb.so.3
+  --scan DIRS
+    Instead of library-name, DIRS is a colon-separated list of directories, e.g. --scan /usr/lib:/usr/local:/opt.
+    Each directory is walked (not following symbolic links to directories) by its own process, all at once.
+    Any *.so or *.so.* file that is ELF with mysql_init and mysql_real_connect defined in its dynamic symbol table
+    is a Connector C library -- there is no dlopen() during the walk. Files that are the same inode, e.g.
+    libmysqlclient.so -> libmysqlclient.so.21, or have the same GNU build-id, e.g. a copy, are traced once.
+    Then each library is traced by a worker, with at most PGOPTIONFILES_MAX_WORKERS or number-of-CPUs at once,
+    and the output is one report for the host, with each library's part in the order its worker ended:
+      (pgoptionfiles)(scan hostname)(libraries 2)(duplicates 1)
+      (pgoptionfiles)(library /usr/lib/x86_64-linux-gnu/libmariadb.so.3)(Connector C version 3.3.8)
+      /etc/my.cnf
+      ...
+      (pgoptionfiles)(library /opt/mysql/lib/libmysqlclient.so.21)(also /opt/mysql/lib/libmysqlclient.so)(Connector C version 8.0.36)
+      ...
+    That's for --format newline or nul. With --format json it's JSON Lines: one {"scan":...} object,
+    then one object per library like the usual json output. --query and --backend and --metrics apply to each library.
+    Return code is 0 if every trace succeeded, else the first failure's.
+  --pid PID
+    Instead of library-name: attach to a running process that already has Connector C loaded, e.g. a service that
+    reconnects now and then, and list the option files it reads on its next connect, with status from what really
+    happened (ok or an errno name, never denied, because nothing the process does is changed).
+    Every thread is seized, and threads it starts later. Only names ending in ".cnf" count.
+    Tracing ends PGOPTIONFILES_ATTACH_QUIET_MILLISECONDS (500) after the latest option file, or PGOPTIONFILES_ATTACH_SECONDS (60)
+    after attaching if the process reads none, or when it ends. Then pgoptionfiles detaches and the process carries on.
+    The first line is "(pgoptionfiles)(pid PID)". It needs permission to ptrace the process, e.g. same user and
+    kernel.yama.ptrace_scope=0, or CAP_SYS_PTRACE. --record and --metrics and --format and --verify work as usual.
+      pgoptionfiles --pid 4242 --format json
+  --backend ptrace or --backend seccomp
+    ptrace is the default. With seccomp the tracee installs a seccomp filter so that only the syscalls with
+    file names (open, access, stat, openat etc.) go to pgoptionfiles, as user notifications, and every other
+    syscall costs nothing extra. There are two context switches per relevant syscall instead of four per syscall,
+    and the file name comes from one pread() of /proc/pid/mem instead of a PTRACE_PEEKDATA per 8 bytes.
+    Needs Linux 5.5 or later (the end of the tracee is seen through a pidfd before 5.8, which needs 5.3, so there's
+    nothing more to it). Output is the same except that status is denied or unknown, never ok or an errno,
+    because pgoptionfiles answers before the syscall happens. See the SECCOMP BACKEND section.
+  --backend dlmopen
+    No tracee, no ptrace(), no seccomp: the library is loaded into pgoptionfiles itself with dlmopen(LM_ID_NEWLM),
+    i.e. in a separate namespace with its own copy of libc, and in that namespace the calls to open, fopen, access,
+    stat etc. are redirected (by changing GOT entries) to pgoptionfiles functions that note the file name and fail
+    with ENOENT, or with --read call the real function. So the cost is only the connector's own work.
+    A program that #includes pgoptionfiles.h can do this in its own process by setting options.is_dlmopen and
+    calling pgoptionfiles_run(). Only for x86_64 and aarch64. Not with --root or --record or --profile.
+    It sees only calls that go through the connector's (or its libraries') GOT, not e.g. syscall(SYS_open ...),
+    and a connector crash is a pgoptionfiles crash. See the DLMOPEN BACKEND section.
+  TESTING AND BENCHMARKING WITHOUT A REAL CONNECTOR
+    mockmysqlclient.c is a stand-in Connector C library with configurable option-file accesses, see its comments.
+      gcc -shared -fPIC -o libmockmysqlclient.so mockmysqlclient.c
+      PGOPTIONFILES_MOCK_FILES=100 ./pgoptionfiles ./libmockmysqlclient.so
+    pgoptionfiles_bench.sh builds both and times pgoptionfiles from a handful of files up to thousands in
+    nested !includedir directories, e.g. sh pgoptionfiles_bench.sh 1 10 100 1000 4000
   USE IN OCELOTGUI
+    Instead of popen() as below, which blocks till pgoptionfiles exits, a build with -DPGOPTIONFILES_LIBRARY=1 can be
+    linked in and pgoptionfiles_async_start() + pgoptionfiles_async_pump() used from the Qt event loop, see the ASYNC section.
     The intent for version 2.6 is to use something like this in https://github.com/ocelot-inc/ocelotgui
       FILE *fp= popen(ApplicationDirPath/pgoptionfiles 2>&1 library_found_with_pgfindlib.so", "r");
       {
@@ -130,34 +344,429 @@
 
 #include "pgoptionfiles.h" /* all #defines and function declarations */
 
+#if (PGOPTIONFILES_TRACEE_PROGRAM == 1)
+/*
+  pgoptionfiles_tracee sync-fd load|options root-directory-or-empty library-name [group file-or-empty]...
+  This isn't for people, pgoptionfiles_tracee_spawn() makes the arguments. load|options is where tracing starts.
+*/
+int main(int argc, char **argv)
+{
+  struct pgoptionfiles_options options;
+  memset(&options, 0, sizeof(options));
+  if ((argc < 5) || (((argc - 5) % 2) != 0) || ((argc - 5) / 2 > PGOPTIONFILES_MAX_QUERIES))
+  {
+    printf("(pgoptionfiles)Error: pgoptionfiles_tracee is started by pgoptionfiles, not directly.\n");
+    exit(1);
+  }
+  int sync_fd= atoi(argv[1]);
+  options.is_profile= (strcmp(argv[2], "load") == 0); /* only --profile wants the load phase traced */
+  if (options.is_profile == 1)
+  {
+    char startup_byte= '\0'; /* start-up is over, pgoptionfiles_run_ptrace() waits for this before the tracer seizes */
+    if (write(sync_fd, &startup_byte, 1) != 1) exit(1);
+  }
+  if (argv[3][0] != '\0') options.root_directory= argv[3];
+  options.library_name= argv[4];
+  for (int i= 5; i < argc; i+= 2)
+  {
+    options.queries[options.query_count].group= argv[i];
+    options.queries[options.query_count].file= (argv[i + 1][0] == '\0') ? NULL : argv[i + 1];
+    ++options.query_count;
+  }
+  pgoptionfiles_tracee(&options, sync_fd);
+  return 1; /* pgoptionfiles_tracee() doesn't return */
+}
+#elif (PGOPTIONFILES_LIBRARY == 0)
 int main(int argc, char **argv)
 {
-  char file_names_list[PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE]= ""; 
   char error_list[4096]= "(pgoptionfiles)";
   int result_code= 0;
-  if (argc < 2)
+  struct pgoptionfiles_options options;
+  if (pgoptionfiles_options_parse(argc, argv, &options, error_list) != 0)
   {
-    printf("(pgoptionfiles)Error: too few args. Say pgoptionfiles library-file\n");
+    printf("%s\n", error_list);
     exit(1);
   }
 #if (PGOPTIONFILES_TRACEE_ONLY == 1)
-  pgoptionfiles_tracee(argv[1]);
+  pgoptionfiles_tracee(&options, -1);
 #else
+  if (options.is_tracee_only == 1)
+  {
+    pgoptionfiles_is_tracee_printing= 1;
+    pgoptionfiles_tracee(&options, -1);
+    return 0;
+  }
+  if (options.is_compare_placement == 1)
+    return pgoptionfiles_compare_placement(&options);
+  if (options.is_diff == 1)
+    return pgoptionfiles_diff(&options);
+  if (options.scan_directories != NULL)
+    return pgoptionfiles_scan(&options);
+  if ((options.root_directories != NULL) && (options.root_directory == NULL))
+    return pgoptionfiles_roots(&options);
+  if ((options.format != NULL) && (strcmp(options.format, "stream") == 0))
+    return pgoptionfiles_stream(&options, STDOUT_FILENO);
+  struct pgoptionfiles_list file_names_list;
+  pgoptionfiles_list_init(&file_names_list);
+  result_code= pgoptionfiles_run(&file_names_list, error_list, &options);
+  if (options.is_verify == 1) pgoptionfiles_verify(&file_names_list, options.root_directory);
+  pgoptionfiles_output(STDOUT_FILENO, &file_names_list, error_list, result_code, options.format, options.delimiter);
+  if (options.is_watch == 1)
+    result_code= pgoptionfiles_watch(&file_names_list, error_list, &options);
+  pgoptionfiles_list_free(&file_names_list);
+#endif
+  return result_code; /* program end */
+}
+#endif
+
+/* Options that take a value, i.e. the ones that pgoptionfiles_options_parse() handles after its "needs a value" check */
+static const char *pgoptionfiles_value_options[]=
+  {"--record", "--replay", "--scan", "--delimiter", "--placement", "--sched", "--pid", "--root", "--query", "--backend",
+   "--format", "--metrics", NULL};
+
+/*
+  Pass: main()'s argc + argv
+  Do: fill in options. Options start with "--", the other argument is the library name.
+  Return: 0 ok, -1 error (with "Error: ..." appended to error_list)
+*/
+int pgoptionfiles_options_parse(int argc, char **argv, struct pgoptionfiles_options *options, char *error_list)
+{
+  memset(options, 0, sizeof(*options));
+  options->is_read= PGOPTIONFILES_READ;
+  options->is_timeout= PGOPTIONFILES_USE_TIMEOUT;
+  options->delimiter= PGOPTIONFILES_DELIMITER;
+  options->is_tracee_only= PGOPTIONFILES_TRACEE_ONLY;
+  for (int i= 1; i < argc; ++i)
+  {
+    const char *arg= argv[i];
+    if (strncmp(arg, "--", 2) != 0)
+    {
+      if (options->library_name == NULL) options->library_name= arg;
+      else if ((options->library_name_2 == NULL) && (options->is_diff == 1)) options->library_name_2= arg;
+      else { strcat(error_list, "Error: too many library-file args."); return -1; }
+      continue;
+    }
+    if (strcmp(arg, "--diff") == 0) { options->is_diff= 1; continue; }
+    if (strcmp(arg, "--watch") == 0) { options->is_watch= 1; continue; }
+    if (strcmp(arg, "--profile") == 0) { options->is_profile= 1; continue; }
+    if (strcmp(arg, "--verify") == 0) { options->is_verify= 1; continue; }
+    if (strcmp(arg, "--read") == 0) { options->is_read= 1; continue; }
+    if (strcmp(arg, "--no-read") == 0) { options->is_read= 0; continue; }
+    if (strcmp(arg, "--timeout") == 0) { options->is_timeout= 1; continue; }
+    if (strcmp(arg, "--no-timeout") == 0) { options->is_timeout= 0; continue; }
+    if (strcmp(arg, "--tracee-only") == 0) { options->is_tracee_only= 1; continue; }
+    if (strcmp(arg, "--perf-counters") == 0) { options->is_perf_counters= 1; continue; }
+    if (strcmp(arg, "--compare-placement") == 0) { options->is_compare_placement= 1; continue; }
+    if (strcmp(arg, "--coalesce") == 0) { options->is_coalesce= 1; continue; }
+    int is_value_option= 0;
+    for (int v= 0; pgoptionfiles_value_options[v] != NULL; ++v)
+      if (strcmp(arg, pgoptionfiles_value_options[v]) == 0) is_value_option= 1;
+    if (is_value_option == 0) { sprintf(error_list + strlen(error_list), "Error: unknown option %.256s.", arg); return -1; }
+    if (i + 1 >= argc) { sprintf(error_list + strlen(error_list), "Error: %.256s needs a value.", arg); return -1; }
+    if (strcmp(arg, "--record") == 0) options->record_file_name= argv[++i];
+    else if (strcmp(arg, "--replay") == 0) options->replay_file_name= argv[++i];
+    else if (strcmp(arg, "--scan") == 0) options->scan_directories= argv[++i];
+    else if (strcmp(arg, "--delimiter") == 0)
+    {
+      const char *delimiter= argv[++i];
+      if (strcmp(delimiter, "\\n") == 0) options->delimiter= '\n';
+      else if (strcmp(delimiter, "\\t") == 0) options->delimiter= '\t';
+      else if ((delimiter[0] != '\0') && (delimiter[1] == '\0')) options->delimiter= delimiter[0];
+      else { strcat(error_list, "Error: --delimiter needs one character, or \\n or \\t."); return -1; }
+    }
+    else if (strcmp(arg, "--placement") == 0)
+    {
+      options->placement= argv[++i];
+      char name[16];
+      snprintf(name, sizeof(name), "%.*s", (int) strcspn(options->placement, ","), options->placement);
+      const char *comma= strchr(options->placement, ',');
+      if (((strcmp(name, "none") != 0) && (strcmp(name, "same") != 0) && (strcmp(name, "siblings") != 0) && (strcmp(name, "spread") != 0))
+       || ((comma != NULL) && ((comma[1] < '0') || (comma[1] > '9'))))
+      { strcat(error_list, "Error: --placement must be none or same or siblings or spread, maybe followed by ,CPU-number."); return -1; }
+    }
+    else if (strcmp(arg, "--sched") == 0)
+    {
+      options->sched= argv[++i];
+      if ((strcmp(options->sched, "other") != 0) && (strcmp(options->sched, "batch") != 0) && (strcmp(options->sched, "idle") != 0)
+       && (strcmp(options->sched, "fifo") != 0) && (strcmp(options->sched, "rr") != 0))
+      { strcat(error_list, "Error: --sched must be other or batch or idle or fifo or rr."); return -1; }
+    }
+    else if (strcmp(arg, "--pid") == 0)
+    {
+      options->attach_pid= (pid_t) atoi(argv[++i]);
+      if (options->attach_pid <= 0) { strcat(error_list, "Error: --pid needs a process id."); return -1; }
+    }
+    else if (strcmp(arg, "--root") == 0)
+    {
+      options->root_directories= argv[++i];
+      if (strchr(options->root_directories, ':') == NULL) options->root_directory= options->root_directories;
+    }
+    else if (strcmp(arg, "--query") == 0)
+    {
+      if (options->query_count == PGOPTIONFILES_MAX_QUERIES) { strcat(error_list, "Error: too many --query options."); return -1; }
+      char *group= argv[++i];
+      char *comma= strchr(group, ',');
+      if (comma != NULL) *comma= '\0';
+      if ((*group == '\0') || (strlen(group) + ((comma == NULL) ? 0 : strlen(comma + 1) + 1) >= PGOPTIONFILES_QUERY_LABEL_SIZE))
+      { strcat(error_list, "Error: --query needs GROUP[,FILE] and not too long."); return -1; }
+      options->queries[options->query_count].group= group;
+      options->queries[options->query_count].file= ((comma == NULL) || (comma[1] == '\0')) ? NULL : comma + 1;
+      ++options->query_count;
+    }
+    else if (strcmp(arg, "--backend") == 0)
+    {
+      ++i;
+      if (strcmp(argv[i], "seccomp") == 0) options->is_seccomp= 1;
+      else if (strcmp(argv[i], "dlmopen") == 0) options->is_dlmopen= 1;
+      else if (strcmp(argv[i], "ptrace") != 0) { strcat(error_list, "Error: --backend must be ptrace or seccomp or dlmopen."); return -1; }
+    }
+    else if (strcmp(arg, "--format") == 0)
+    {
+      options->format= argv[++i];
+      if ((strcmp(options->format, "newline") != 0) && (strcmp(options->format, "nul") != 0)
+       && (strcmp(options->format, "json") != 0) && (strcmp(options->format, "csv") != 0) && (strcmp(options->format, "stream") != 0))
+      {
+        strcat(error_list, "Error: --format must be newline or nul or json or csv or stream.");
+        return -1;
+      }
+    }
+    else if (strcmp(arg, "--metrics") == 0)
+    {
+      options->metrics_format= argv[++i];
+      if ((strcmp(options->metrics_format, "json") != 0) && (strcmp(options->metrics_format, "prometheus") != 0))
+      {
+        strcat(error_list, "Error: --metrics must be json or prometheus.");
+        return -1;
+      }
+    }
+    else { sprintf(error_list + strlen(error_list), "Error: unknown option %.256s.", arg); return -1; }
+  }
+  if ((options->is_tracee_only == 1)
+   && (options->record_file_name != NULL || options->replay_file_name != NULL || options->is_diff == 1
+   || options->metrics_format != NULL || options->format != NULL || options->is_watch == 1 || options->is_seccomp == 1
+   || options->is_dlmopen == 1
+   || options->scan_directories != NULL || options->root_directories != NULL || options->is_profile == 1 || options->is_verify == 1
+   || options->attach_pid != 0 || options->is_perf_counters == 1
+   || options->placement != NULL || options->sched != NULL || options->is_compare_placement == 1 || options->is_coalesce == 1))
+  {
+    strcat(error_list, "Error: --record and --replay and --diff and --metrics and --format and --watch and --backend and --scan and --root and --profile and --verify and --pid and --perf-counters and --placement and --sched and --compare-placement and --coalesce need the tracer, so not with --tracee-only or a PGOPTIONFILES_TRACEE_ONLY build.");
+    return -1;
+  }
+  if ((options->is_coalesce == 1)
+   && ((options->attach_pid != 0) || (options->replay_file_name != NULL) || (options->record_file_name != NULL)
+    || (options->metrics_format != NULL) || (options->is_profile == 1) || (options->is_perf_counters == 1) || (options->is_compare_placement == 1)))
+  {
+    strcat(error_list, "Error: --coalesce shares one trace's file list, so not with --pid or --replay or --record or --metrics or --profile or --perf-counters or --compare-placement, which need a trace of their own.");
+    return -1;
+  }
+  int is_several_tracers= (options->is_diff == 1) || (options->scan_directories != NULL)
+                       || ((options->root_directories != NULL) && (options->root_directory == NULL));
+  if ((options->is_verify == 1)
+   && ((options->format == NULL) || ((strcmp(options->format, "json") != 0) && (strcmp(options->format, "csv") != 0))))
+  {
+    strcat(error_list, "Error: --verify adds columns to --format json or csv, so not with --format newline or nul or stream.");
+    return -1;
+  }
+  if ((options->format != NULL) && (strcmp(options->format, "stream") == 0)
+   && ((is_several_tracers == 1) || (options->is_watch == 1) || (options->is_compare_placement == 1)))
+  {
+    strcat(error_list, "Error: --format stream is one pgoptionfiles_run() for pgoptionfiles_async_start(), so not with --diff or --scan or more than one --root DIR or --watch or --compare-placement.");
+    return -1;
+  }
+  if ((options->placement != NULL) && (is_several_tracers == 1))
+  {
+    strcat(error_list, "Error: --placement is for one tracer and tracee, so not with --diff or --scan or more than one --root DIR.");
+    return -1;
+  }
+  if ((options->is_compare_placement == 1)
+   && ((options->library_name == NULL) || (is_several_tracers == 1) || (options->placement != NULL)
+    || (options->record_file_name != NULL) || (options->is_watch == 1) || (options->is_seccomp == 1) || (options->is_dlmopen == 1)
+    || (options->metrics_format != NULL) || (options->is_profile == 1) || (options->is_perf_counters == 1) || (options->is_timeout == 1)))
+  {
+    strcat(error_list, "Error: --compare-placement times one library-file with --backend ptrace, so not with --placement or --diff or --scan or --pid or --replay or --record or --watch or --backend or --metrics or --profile or --perf-counters or --timeout (in a -DPGOPTIONFILES_USE_TIMEOUT=1 build, add --no-timeout) or more than one --root DIR.");
+    return -1;
+  }
+  if (options->scan_directories != NULL)
+  {
+    if ((options->library_name != NULL) || (options->replay_file_name != NULL) || (options->record_file_name != NULL)
+     || (options->is_diff == 1) || (options->is_watch == 1) || (options->root_directories != NULL)
+     || ((options->format != NULL) && (strcmp(options->format, "csv") == 0)))
+    {
+      strcat(error_list, "Error: --scan finds the library-files itself, and can't be with --replay or --record or --diff or --watch or --format csv.");
+      return -1;
+    }
+    return 0;
+  }
+  if (options->attach_pid != 0)
+  {
+    if ((options->library_name != NULL) || (options->replay_file_name != NULL) || (options->is_diff == 1)
+     || (options->is_watch == 1) || (options->root_directories != NULL) || (options->query_count > 0)
+     || (options->is_profile == 1) || (options->is_seccomp == 1) || (options->is_dlmopen == 1))
+    {
+      strcat(error_list, "Error: --pid traces a running process, so no library-file or --replay or --diff or --watch or --root or --query or --profile or --backend seccomp or --backend dlmopen.");
+      return -1;
+    }
+    return 0;
+  }
+  if ((options->library_name == NULL) && (options->replay_file_name == NULL))
+  {
+    strcat(error_list, "Error: too few args. Say pgoptionfiles library-file");
+    return -1;
+  }
+  if ((options->library_name != NULL) && (options->replay_file_name != NULL))
+  {
+    strcat(error_list, "Error: --replay and library-file are mutually exclusive.");
+    return -1;
+  }
+  if ((options->is_diff == 1)
+   && ((options->library_name_2 == NULL) || (options->record_file_name != NULL) || (options->replay_file_name != NULL)
+    || (options->query_count > 0)))
+  {
+    strcat(error_list, "Error: --diff needs two library-file args and no --record or --replay or --query.");
+    return -1;
+  }
+  if ((options->root_directories != NULL)
+   && ((options->library_name == NULL) || (options->is_diff == 1) || (options->is_watch == 1)
+    || ((options->record_file_name != NULL) && (options->root_directory == NULL))))
+  {
+    strcat(error_list, "Error: --root needs a library-file and no --replay or --diff or --watch, and --record only if one DIR.");
+    return -1;
+  }
+  if ((options->is_profile == 1) && ((options->replay_file_name != NULL) || (options->is_seccomp == 1) || (options->is_dlmopen == 1)))
+  {
+    strcat(error_list, "Error: --profile needs syscall exits, so not with --replay or --backend seccomp or --backend dlmopen.");
+    return -1;
+  }
+  if ((options->is_dlmopen == 1) && ((options->root_directories != NULL) || (options->record_file_name != NULL)))
+  {
+    strcat(error_list, "Error: --backend dlmopen has no tracee to chroot and no syscalls to record, so not with --root or --record.");
+    return -1;
+  }
+  if ((options->is_watch == 1) && ((options->library_name == NULL) || (options->is_diff == 1)))
+  {
+    strcat(error_list, "Error: --watch needs a library-file and no --replay or --diff.");
+    return -1;
+  }
+  return 0;
+}
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  Pass: options, the usual main() buffers
+  Do: one complete job, i.e. replay, or fork + tracee + tracer
+  Return: pgoptionfiles_tracer() result
+  Output is left in file_names_list and error_list, the caller decides where it goes.
+*/
+int pgoptionfiles_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  if (options->replay_file_name != NULL)
+    return pgoptionfiles_replay(file_names_list, error_list, options);
+  if (options->is_coalesce == 1)
+    return pgoptionfiles_coalesce(file_names_list, error_list, options);
+  int result;
+#if (PGOPTIONFILES_PREFETCH == 1)
+  /*
+    Before the tracee exists, so it gets ahead of the tracee's dlopen(), which reads the DT_NEEDED files one at a time.
+    Not for --root, it has another ld.so.cache. Not with --placement, where a third process would skew what's compared.
+  */
+  pthread_t prefetch_thread;
+  int is_prefetch= 0;
+  if ((options->is_dlmopen == 0) && (options->attach_pid == 0) && (options->root_directory == NULL) && (options->placement == NULL))
+    is_prefetch= (pgoptionfiles_prefetch_start(options->library_name, &prefetch_thread) == 0);
+#endif
+  if (pgoptionfiles_placement_start(options, error_list) != 0) result= -1;
+  else
+  {
+    if (options->is_seccomp == 1)
+      result= pgoptionfiles_seccomp_run(file_names_list, error_list, options);
+    else if (options->is_dlmopen == 1)
+      result= pgoptionfiles_dlmopen_run(file_names_list, error_list, options);
+    else if (options->attach_pid != 0)
+      result= pgoptionfiles_attach(file_names_list, error_list, options);
+    else
+      result= pgoptionfiles_run_ptrace(file_names_list, error_list, options);
+    pgoptionfiles_placement_end();
+  }
+#if (PGOPTIONFILES_PREFETCH == 1)
+  if (is_prefetch) pthread_join(prefetch_thread, NULL);
+#endif
+  return result;
+}
+
+/* pgoptionfiles_run() for --backend ptrace: fork or spawn the tracee, then be its tracer */
+int pgoptionfiles_run_ptrace(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  int sync_fds[2]; /* tracee writes "ready" to [0], then blocks reading [0] until tracer has seized it and writes to [1] */
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sync_fds) != 0) { strcat(error_list, "Error: socketpair() failed"); return -1; }
   pid_t pid;
-  pid= fork();
-  if (pid < 0) { printf("(pgoptionfiles)Error: fork() failed\n"); return -1; }
+  pid= pgoptionfiles_tracee_spawn(options, sync_fds[0], sync_fds[1]);
+  int is_spawned= (pid > 0);
+  if (pid < 0) pid= fork();
+  if (pid < 0) { close(sync_fds[0]); close(sync_fds[1]); strcat(error_list, "Error: fork() failed"); return -1; }
   if (pid == 0)
   {
-    pgoptionfiles_tracee(argv[1]);
+    close(sync_fds[1]);
+    pgoptionfiles_tracee(options, sync_fds[0]);
   }
+  close(sync_fds[0]);
+  if (is_spawned && (options->is_profile == 1))
   {
-    result_code= pgoptionfiles_tracer(pid, file_names_list, error_list);
+    /* so that --profile's load phase starts where a fork()ed tracee's would, after exec and ld.so */
+    char startup_byte;
+    while ((read(sync_fds[1], &startup_byte, 1) < 0) && (errno == EINTR)) {;}
   }
-  printf("%s\n", error_list);
-  printf("%s\n", file_names_list);
+  pgoptionfiles_placement_tracee(pid);
+  return pgoptionfiles_tracer(pid, sync_fds[1], file_names_list, error_list, options);
+}
+
+/*
+  Pass: options, the tracee's and the tracer's ends of the sync pipe
+  Do: posix_spawn() PGOPTIONFILES_TRACEE_PROGRAM_NAME from the directory that this program is in
+  Return: pid, or -1 if there's no such program or it can't be started, then the caller should fork()
+*/
+pid_t pgoptionfiles_tracee_spawn(const struct pgoptionfiles_options *options, int sync_fd, int tracer_sync_fd)
+{
+  char program_name[PATH_MAX];
+  char sync_fd_string[16];
+  char *argv[5 + PGOPTIONFILES_MAX_QUERIES * 2 + 1];
+  ssize_t length= readlink("/proc/self/exe", program_name, sizeof(program_name) - sizeof(PGOPTIONFILES_TRACEE_PROGRAM_NAME) - 1);
+  if (length <= 0) return -1;
+  program_name[length]= '\0';
+  char *slash= strrchr(program_name, '/');
+  if (slash == NULL) return -1;
+  strcpy(slash + 1, PGOPTIONFILES_TRACEE_PROGRAM_NAME);
+  if (access(program_name, X_OK) != 0) return -1;
+#ifdef PGOPTIONFILES_SPAWN_CLOSEFROM
+  sprintf(sync_fd_string, "%d", 3); /* it's dup2()'d to 3 and everything after is closed, see below */
+#else
+  sprintf(sync_fd_string, "%d", sync_fd);
 #endif
-  return result_code; /* program end */
+  int argc= 0;
+  argv[argc++]= program_name;
+  argv[argc++]= sync_fd_string;
+  argv[argc++]= (char *) ((options->is_profile == 1) ? "load" : "options");
+  argv[argc++]= (char *) ((options->root_directory == NULL) ? "" : options->root_directory);
+  argv[argc++]= (char *) options->library_name;
+  for (int i= 0; i < options->query_count; ++i)
+  {
+    argv[argc++]= (char *) options->queries[i].group;
+    argv[argc++]= (char *) ((options->queries[i].file == NULL) ? "" : options->queries[i].file);
+  }
+  argv[argc]= NULL;
+  posix_spawn_file_actions_t file_actions;
+  if (posix_spawn_file_actions_init(&file_actions) != 0) return -1;
+  posix_spawn_file_actions_addclose(&file_actions, tracer_sync_fd);
+#ifdef PGOPTIONFILES_SPAWN_CLOSEFROM
+  posix_spawn_file_actions_adddup2(&file_actions, sync_fd, 3); /* if sync_fd is 3 this clears FD_CLOEXEC, harmless */
+  posix_spawn_file_actions_addclosefrom_np(&file_actions, 4);
+#endif
+  extern char **environ;
+  pid_t pid;
+  int spawn_result= posix_spawn(&pid, program_name, &file_actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&file_actions);
+  return (spawn_result == 0) ? pid : -1;
 }
+#endif
 
 /*
   ******************* TRACEE ***************
@@ -167,20 +776,57 @@ int main(int argc, char **argv)
 #pragma GCC optimize ("O0")
 #pragma GCC diagnostic ignored "-Wpedantic"
 
-void pgoptionfiles_tracee(const char *argv1)
+/*
+  Pass: sync_fd, 1 if the tracer is waiting for a "ready" byte first (i.e. not --profile)
+  Do: if sync_fd isn't -1 already, say ready if the tracer's waiting for that, wait till traced, set sync_fd= -1
+  So after this, the tracee's fake fopen() messages will be seen. Calling it again does nothing.
+*/
+void pgoptionfiles_tracee_sync(int *sync_fd, int is_deferred)
+{
+  char sync_byte= '\0';
+  ssize_t read_result;
+  if (*sync_fd < 0) return;
+  if (is_deferred && (write(*sync_fd, &sync_byte, 1) != 1)) exit(EXIT_FAILURE);
+  do read_result= read(*sync_fd, &sync_byte, 1); while ((read_result < 0) && (errno == EINTR));
+  close(*sync_fd);
+  *sync_fd= -1;
+  if (read_result != 1) exit(EXIT_FAILURE); /* tracer didn't seize, it has already reported why */
+}
+
+/*
+  Pass: options (library name + queries), sync_fd = the tracee's end of the socketpair that the tracer will write to after PTRACE_SEIZE, or -1
+  Do: load the library and call mysql_init() untraced, wait till traced, then call the library, once per query. Don't return.
+  With --profile, wait till traced before anything, so --profile sees the load phase.
+  An error before the wait is reported after it, so the tracer sees it.
+  If --query: before each query's mysql_options() say "(Connector query group[,file]" so the tracer can split.
+*/
+void pgoptionfiles_tracee(const struct pgoptionfiles_options *options, int sync_fd)
 {
   char connector_c_version[256];
-#if (PGOPTIONFILES_TRACEE_ONLY == 0)
-  ptrace(PTRACE_TRACEME, 0, NULL, NULL);
-  if (raise(SIGSTOP))
+  char query_message[sizeof("(Connector query ") + PGOPTIONFILES_QUERY_LABEL_SIZE];
+  const char *argv1= options->library_name;
+  struct pgoptionfiles_query default_query= {"client", NULL};
+  const struct pgoptionfiles_query *queries= options->queries;
+  int query_count= options->query_count;
+  if (query_count == 0) { queries= &default_query; query_count= 1; }
+  int is_deferred= (options->is_profile == 0);
+  if (!is_deferred) pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) || (PGOPTIONFILES_TRACEE_PROGRAM == 1)
+  if (options->root_directory != NULL)
   {
-    pgoptionfiles_tracee_error_or_message("Error: raise sigstop failed.");
-    goto error_exit_2;
+    const char *root_error= pgoptionfiles_root_enter(options->root_directory);
+    if (root_error != NULL)
+    {
+      pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
+      pgoptionfiles_tracee_error_or_message(root_error);
+      goto error_exit_2;
+    }
   }
 #endif
   void *dlopen_handle= dlopen(argv1, RTLD_LAZY); /* argv[1] should be library file name */
   if (dlopen_handle == NULL)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlopen() failed --does library exist and is it Connector C?");
     goto error_exit_2;
   }
@@ -189,6 +835,7 @@ void pgoptionfiles_tracee(const char *argv1)
   t__mysql_init= (tmysql_init) dlsym(dlopen_handle, "mysql_init");
   if (dlerror() != 0)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlsym() failed for mysql_init() -- is this a Connector C library?");
     goto error_exit_1;
   }
@@ -198,6 +845,7 @@ void pgoptionfiles_tracee(const char *argv1)
   t__mysql_get_client_info= (tmysql_get_client_info) dlsym(dlopen_handle, "mysql_get_client_info");
   if (dlerror() != 0)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlsym() failed for mysql_get_client_info() -- is this a Connector C library?");
     goto error_exit_1;
   }
@@ -207,6 +855,7 @@ void pgoptionfiles_tracee(const char *argv1)
   t__mysql_options= (tmysql_options) dlsym(dlopen_handle, "mysql_options");
   if (dlerror() != 0)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlsym() failed for mysql_options() -- is this a Connector C library?");
     goto error_exit_1;
   }
@@ -218,6 +867,7 @@ void pgoptionfiles_tracee(const char *argv1)
   t__mysql_real_connect= (tmysql_real_connect) dlsym(dlopen_handle, "mysql_real_connect");
   if (dlerror() != 0)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlsym() failed for mysql_real_connect() -- is this a Connector C library?");
     goto error_exit_1;
   }
@@ -227,6 +877,7 @@ void pgoptionfiles_tracee(const char *argv1)
   t__mysql_close= (tmysql_close) dlsym(dlopen_handle, "mysql_close");
   if (dlerror() != 0)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: dlsym() failed for mysql_close() -- is this a Connector C library?");
     goto error_exit_1;
   }
@@ -235,6 +886,7 @@ void pgoptionfiles_tracee(const char *argv1)
   mysql= t__mysql_init(mysql);
   if (!mysql)
   {
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred);
     pgoptionfiles_tracee_error_or_message("Error: mysql_init() failed -- out of memory?");
     goto error_exit_1;
   }
@@ -243,18 +895,45 @@ void pgoptionfiles_tracee(const char *argv1)
     const char *client_info= t__mysql_get_client_info();
     if (client_info != NULL) sprintf(connector_c_version, "(Connector C version %s)", client_info);
     else strcpy(connector_c_version, "((Connector C version unknown)");
+    pgoptionfiles_tracee_sync(&sync_fd, is_deferred); /* tracing starts here, nothing before this reads option files */
     pgoptionfiles_tracee_error_or_message(connector_c_version);
   }
-  /* This tells the connector to try to open all option files, group name doesn't matter */
-  if (t__mysql_options(mysql, MYSQL_READ_DEFAULT_GROUP, "client") == 1)
+  for (int query_number= 0; query_number < query_count; ++query_number)
   {
-    pgoptionfiles_tracee_error_or_message("Error: mysql_options() failed -- bad syntax in an option file?");
-    goto error_exit_0;
+    if (query_number > 0)
+    {
+      mysql= t__mysql_init(NULL); /* the previous query's mysql_close() freed it */
+      if (!mysql)
+      {
+        pgoptionfiles_tracee_error_or_message("Error: mysql_init() failed -- out of memory?");
+        goto error_exit_1;
+      }
+    }
+    if (options->query_count > 0)
+    {
+      if (queries[query_number].file == NULL) sprintf(query_message, "(Connector query %s", queries[query_number].group);
+      else sprintf(query_message, "(Connector query %s,%s", queries[query_number].group, queries[query_number].file);
+      pgoptionfiles_tracee_error_or_message(query_message);
+    }
+    /* This tells the connector to try to open all option files, group name doesn't matter unless --query */
+    if (t__mysql_options(mysql, MYSQL_READ_DEFAULT_GROUP, queries[query_number].group) == 1)
+    {
+      pgoptionfiles_tracee_error_or_message("Error: mysql_options() failed -- bad syntax in an option file?");
+      goto error_exit_0;
+    }
+    if ((queries[query_number].file != NULL)
+     && (t__mysql_options(mysql, MYSQL_READ_DEFAULT_FILE, queries[query_number].file) == 1))
+    {
+      pgoptionfiles_tracee_error_or_message("Error: mysql_options() failed -- bad syntax in an option file?");
+      goto error_exit_0;
+    }
+    /* The actual reading takes place during mysql_real_connect, failure doesn't matter */
+    pgoptionfiles_tracee_error_or_message("(Connector phase connect");
+    if (t__mysql_real_connect(mysql, "localhost", "","", "", 3309, NULL, 0) != 0)
+      pgoptionfiles_tracee_error_or_message("Error: mysql_real_connect() succeeded -- this is probably harmless.");
+    pgoptionfiles_tracee_error_or_message("(Connector phase close");
+    t__mysql_close(mysql);
   }
-  /* The actual reading takes place during mysql_real_connect, failure doesn't matter */
-  if (t__mysql_real_connect(mysql, "localhost", "","", "", 3309, NULL, 0) != 0)
-    pgoptionfiles_tracee_error_or_message("Error: mysql_real_connect() succeeded -- this is probably harmless.");
-  t__mysql_close(mysql);
   dlclose(dlopen_handle);
   pgoptionfiles_tracee_error_or_message("(Connector exit");
   exit(EXIT_SUCCESS);
@@ -270,19 +949,24 @@ error_exit_2:
   Pass: the message for an error in tracee()
   Do: a fake fopen() -- all tracee messages start with "Error: " or "(Connector ",
   the tracer looks for openat that starts with such signals 
+  "(Connector phase ..." messages only mark where mysql_real_connect() etc. start, for --metrics.
+  "(Connector query ..." messages mark where each --query starts.
 
   Doing all messages via fake accesses will guarantee that the tracer sees all (messages + real accesses) in sequence.
   Since real files don't have names with this format, failure is certain. But success is harmless.
   Turn warning off for -Wno-unused-result by letting fopen return a value.
 */
+int pgoptionfiles_is_tracee_printing= (PGOPTIONFILES_TRACEE_ONLY == 1) && (PGOPTIONFILES_TRACEE_PROGRAM == 0); /* i.e. --tracee-only */
+
 void pgoptionfiles_tracee_error_or_message(const char * message)
 {
-#if (PGOPTIONFILES_TRACEE_ONLY == 1)
-  printf("%s\n", message);
-#else
+  if (pgoptionfiles_is_tracee_printing == 1)
+  {
+    printf("%s\n", message);
+    return;
+  }
   FILE *fp= fopen(message, "r");
   if (fp != NULL) fclose(fp);
-#endif
 }
 
 #pragma GCC pop_options
@@ -292,29 +976,130 @@ void pgoptionfiles_tracee_error_or_message(const char * message)
 */
 
 #if (PGOPTIONFILES_TRACEE_ONLY == 0)
-int pgoptionfiles_tracer(pid_t pid, char *file_names_list, char *error_list)
+static inline __attribute__((always_inline))
+int pgoptionfiles_tracer_file_name_policy(struct pgoptionfiles_state *state, const char *file_name, const int is_read);
+
+/*
+  The tracer loop, for one policy: is_read and is_timeout are constants in each caller (pgoptionfiles_tracer_0_0 etc.
+  below), so after inlining each variant has only its own code on the per-stop path, as if it were a build with
+  -DPGOPTIONFILES_READ=is_read -DPGOPTIONFILES_USE_TIMEOUT=is_timeout. pgoptionfiles_tracer() picks the variant.
+*/
+static inline __attribute__((always_inline))
+int pgoptionfiles_tracer_policy(pid_t pid, int sync_fd, struct pgoptionfiles_list *file_names_list, char *error_list,
+                                const struct pgoptionfiles_options *options, const int is_read, const int is_timeout)
 {
   int status= 0;
-  int retcode= 0;
-  int is_connector_message_seen= 0;
-  /* In this loop, odd trace_number is entry and even trace_number (other than 0) is exit), we worry only about entry */
-  /* (They alternate because there are no other choices because the seccomp flag is off.) */
+  struct pgoptionfiles_state state;
+  memset(&state, 0, sizeof(state));
+  state.options= options;
+  state.file_names_list= file_names_list;
+  state.last_entry_number= -1;
+  state.error_list= error_list;
+  state.fd_cache= malloc(sizeof(*state.fd_cache)); /* if NULL it's just slower */
+  if (state.fd_cache != NULL) state.fd_cache->count= state.fd_cache->next= 0;
+  clock_gettime(CLOCK_MONOTONIC, &state.start_time);
+  pgoptionfiles_perf_open(&state, pid);
+  /*
+    Unless --profile, the tracee does dlopen() + dlsym() + mysql_init() untraced, then says it's ready.
+    That's all of the load phase, which is otherwise thousands of stops for nothing. For --metrics
+    the load phase is still the time from here to the first stop.
+  */
+  if (options->is_profile == 0)
+  {
+    char ready_byte;
+    ssize_t read_result= 0;
+    if (is_timeout == 1)
+    {
+      /* The same deadline as the waitpid() loop below, a library whose load hangs is as bad as a syscall that does */
+      struct pollfd poll_fd= {sync_fd, POLLIN, 0};
+      int poll_result= 0;
+      for (useconds_t usleep_mikes= 125; usleep_mikes < 4096000; usleep_mikes= usleep_mikes * 2)
+      {
+        poll_result= poll(&poll_fd, 1, (usleep_mikes + 999) / 1000);
+        if ((poll_result != 0) && !((poll_result < 0) && (errno == EINTR))) break;
+      }
+      if (poll_result <= 0)
+      {
+        kill(pid, SIGKILL);
+        close(sync_fd);
+        waitpid(pid, &status, 0);
+        pgoptionfiles_perf_close(&state);
+        free(state.fd_cache);
+        strcat(error_list, "Error: timeout while the tracee was loading the library.");
+        return -3;
+      }
+    }
+    do read_result= read(sync_fd, &ready_byte, 1); while ((read_result < 0) && (errno == EINTR));
+    if (read_result != 1)
+    {
+      close(sync_fd);
+      waitpid(pid, &status, 0);
+      pgoptionfiles_perf_close(&state);
+      free(state.fd_cache);
+      if (WIFSIGNALED(status)) sprintf(error_list + strlen(error_list), "Error: tracee killed by signal %d while loading the library.", WTERMSIG(status));
+      else strcat(error_list, "Error: tracee ended while loading the library.");
+      return -3;
+    }
+  }
+  /*
+    The tracee is blocked reading sync_fd. Seize it, with options that last for the whole trace:
+    EXITKILL so the tracee can't outlive the tracer, TRACESYSGOOD so syscall stops are distinguishable from signals,
+    TRACEEXIT so the tracee's end is seen. Then interrupt it once so that PTRACE_SYSCALL is possible.
+    Closing sync_fd without writing makes the tracee exit, that's the way to clean up if anything fails.
+  */
+  if ((ptrace(PTRACE_SEIZE, pid, NULL, (void *) (long) (PTRACE_O_EXITKILL | PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEEXIT)) < 0)
+   || (ptrace(PTRACE_INTERRUPT, pid, NULL, NULL) < 0))
+  {
+    close(sync_fd);
+    waitpid(pid, &status, 0);
+    pgoptionfiles_perf_close(&state);
+    free(state.fd_cache);
+    strcat(error_list, "Error: ptrace(PTRACE_SEIZE) failed -- is ptrace() allowed?");
+    return -3;
+  }
+  if (pgoptionfiles_record_open(&state) != 0)
+  {
+    kill(pid, SIGKILL);
+    close(sync_fd);
+    waitpid(pid, &status, 0);
+    pgoptionfiles_perf_close(&state);
+    free(state.fd_cache);
+    return state.retcode;
+  }
+  int is_metrics= (options->metrics_format != NULL) || (options->is_perf_counters == 1) /* perf-counters needs phase times */
+                || (options->metrics_result != NULL);
+  int is_tracee_ended= 0;
+  if (options->is_profile == 1)
+  {
+    state.profile= calloc(1, sizeof(struct pgoptionfiles_profile));
+    if (state.profile == NULL) strcat(error_list, "Error: out of memory for --profile, continuing without it.");
+  }
+  /* With --record the entry stop is copied to record, then written at exit stop when syscall_result is known */
+  struct pgoptionfiles_record record;
+  char record_file_name[PATH_MAX];
+  int is_record_pending= 0;
+  /* Syscall stops alternate entry, exit, entry, exit ... so is_in_syscall tells which. Other stops don't change it. */
+  int is_in_syscall= 0;
+  int resume_signal= 0; /* if a stop was for a signal, pass it on */
   for (unsigned int trace_number= 0; ; ++trace_number)
   {
     if (trace_number > 0)
     {
-      if (ptrace(PTRACE_SYSCALL, pid, NULL, NULL) < 0)
+      if (ptrace(PTRACE_SYSCALL, pid, NULL, (void *) (long) resume_signal) < 0)
       {
         /* errno could be EPERM or ESRCH or EIO but those are impossible so don't bother to look, just end */
-        retcode= -1;
+        state.retcode= -1;
         break;
       }
+      resume_signal= 0;
     }
-    /* Wait for pid (tracee). First time will be wait for SIGSTOP, later times will be wait for SYSCALL result. */
+    /* Wait for pid (tracee). First time will be wait for PTRACE_INTERRUPT, later times will be wait for SYSCALL result. */
     int waitpid_result= 0; /* can be -1 (error), 0 (not yet changed state), or > 0 (child process id) */
-#if (PGOPTIONFILES_USE_TIMEOUT == 0) /* The usual setting since the timeout loop is a bit expensive */
+    int64_t waitpid_start= 0;
+    if (is_metrics) waitpid_start= pgoptionfiles_nanoseconds_since(&state.start_time);
+    if (is_timeout == 0) /* The usual setting since the timeout loop is a bit expensive */
       waitpid_result= waitpid(pid, &status, 0);
-#else
+    else
     {
       for (useconds_t usleep_mikes= 125; usleep_mikes < 4096000; usleep_mikes= usleep_mikes * 2)
       {
@@ -323,32 +1108,84 @@ int pgoptionfiles_tracer(pid_t pid, char *file_names_list, char *error_list)
         usleep(usleep_mikes);
       }
       if (waitpid_result == 0) { /* i.e. if tracee still unresponsive after last usleep which was probably usleep(4096000) */
-        kill(pid, SIGTERM);
+        kill(pid, SIGKILL);
         waitpid(pid, &status, 0); // Wait for the child to actually terminate
+        is_tracee_ended= 1;
         strcat(error_list, "Error: waitpid timeout.");
-        retcode= -1;
+        state.retcode= -1;
         break;
       }
     }
-#endif
+    if (is_metrics)
+    {
+      int64_t waited= pgoptionfiles_nanoseconds_since(&state.start_time) - waitpid_start;
+      state.metrics.waitpid_nanoseconds+= waited;
+      if (state.phase == PGOPTIONFILES_PHASE_LOAD) state.metrics.load_waitpid_nanoseconds+= waited;
+    }
     if (waitpid_result < 0)
     {
-      if (WIFEXITED(status)) retcode= 0;
-      else { strcat(error_list, "Error: waitpid failed."); retcode= -2; }
+      is_tracee_ended= 1;
+      if (WIFEXITED(status)) state.retcode= 0;
+      else { strcat(error_list, "Error: waitpid failed."); state.retcode= -2; }
+      break;
+    }
+    if (WIFEXITED(status)) { is_tracee_ended= 1; state.retcode= 0; break; }
+    if (WIFSIGNALED(status))
+    {
+      is_tracee_ended= 1;
+      sprintf(error_list + strlen(error_list), "Error: tracee killed by signal %d.", WTERMSIG(status));
+      state.retcode= -2;
       break;
     }
-    if (WIFEXITED(status)) { retcode= 0; break; }
     if (trace_number == 0)
     {
-      if (!WIFSTOPPED(status) || WSTOPSIG(status) != SIGSTOP) {
+      if (!WIFSTOPPED(status) || ((status >> 16) != PTRACE_EVENT_STOP)) {
         kill(pid, SIGKILL);
         sprintf(error_list + strlen(error_list), "Error: waitpid status: %x.", status);
-        retcode= -3;
+        state.retcode= -3;
         break;
       }
+      /* Tracee is stopped and seized, now it can stop waiting */
+      if (write(sync_fd, "", 1) != 1) { kill(pid, SIGKILL); strcat(error_list, "Error: sync write failed."); state.retcode= -3; break; }
+      close(sync_fd);
+      sync_fd= -1;
       continue; /* so next thing that happens with be PTRACE_SYSCALL */
     }
-    if ((trace_number %2) == 1) /* like if ( ptrace_syscall_info op == PTRACE_SYSCALL_INFO_ENTRY) */
+    if (WSTOPSIG(status) != (SIGTRAP | 0x80)) /* not a syscall stop */
+    {
+      /* PTRACE_EVENT_EXIT or group-stop or something else with (status >> 16) != 0 are passed over, signals are passed on */
+      if ((status >> 16) == 0) resume_signal= WSTOPSIG(status);
+      continue;
+    }
+    is_in_syscall= !is_in_syscall;
+    ++state.metrics.syscall_stops;
+    if (is_in_syscall == 0) /* exit, the only things to do here are finish a --record and a new entry's syscall_result */
+    {
+      if (state.profile != NULL) pgoptionfiles_profile_exit(&state);
+      if ((is_record_pending == 1) || (state.last_entry_number >= 0))
+      {
+        errno= 0;
+#ifdef __x86_64__
+        long syscall_result= ptrace(PTRACE_PEEKUSER, pid, offsetof(struct user, regs.rax), NULL);
+#else
+        long syscall_result= ptrace(PTRACE_PEEKUSER, pid, offsetof(struct user, regs.eax), NULL);
+#endif
+        if (errno != 0) syscall_result= -ENOSYS;
+        if (state.last_entry_number >= 0)
+        {
+          file_names_list->entries[state.last_entry_number].syscall_result= syscall_result;
+          state.last_entry_number= -1;
+        }
+        if (is_record_pending == 1)
+        {
+          record.syscall_result= syscall_result;
+          pgoptionfiles_record_write(&state, &record, record_file_name);
+          is_record_pending= 0;
+        }
+      }
+      continue;
+    }
+    if (is_in_syscall == 1) /* like if ( ptrace_syscall_info op == PTRACE_SYSCALL_INFO_ENTRY) */
     {
       /* orig_rax or orig_eax should have the number of the system call, like  ptrace_syscall_info entry.nr */
       struct user_regs_struct registers;
@@ -358,137 +1195,371 @@ int pgoptionfiles_tracer(pid_t pid, char *file_names_list, char *error_list)
 #else
       size_t psi_entry_nr= registers.orig_eax;
 #endif
+      PGOPTIONFILES_PROBE2(syscall_entry, pid, psi_entry_nr);
       int arg_number= pgoptionfiles_tracer_arg_number(psi_entry_nr);
+      PGOPTIONFILES_PROBE3(classify, pid, psi_entry_nr, arg_number);
+      if (state.profile != NULL) pgoptionfiles_profile_entry(&state, pid, psi_entry_nr, &registers);
+#ifdef __x86_64__
+      pgoptionfiles_fd_cache_syscall(&state, psi_entry_nr, registers.rdi, registers.rsi);
+#else
+      pgoptionfiles_fd_cache_syscall(&state, psi_entry_nr, registers.ebx, registers.ecx);
+#endif
       if (arg_number >= 0) /* i.e. if psi_entry_nr has relevant-looking const char *filename arg0 or arg1 */
       {
         char file_name[PATH_MAX];
-        file_name[0]= PGOPTIONFILES_DELIMITER;
         int copy_result;
 #ifdef __x86_64__
         if (arg_number == 1)
-          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name + 1, (const char *) registers.rsi); /* arg1 */
+          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name, (const char *) registers.rsi); /* arg1 */
         else
-          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name + 1, (const char *) registers.rdi); /* arg0 */
+          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name, (const char *) registers.rdi); /* arg0 */
 #else
         if (arg_number == 1)
-          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name + 1, (const char *) registers.ecx); /* arg1 */
+          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name, (const char *) registers.ecx); /* arg1 */
         else
-          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name + 1, (const char *) registers.ebx); /* arg0 */
+          copy_result= pgoptionfiles_copy_from_tracee(pid, file_name, (const char *) registers.ebx); /* arg0 */
 #endif
+        ++state.metrics.peekdata_calls;
         if (copy_result > 0)
         {
-          /* if tracee has an error it calls fopen("Error: ...", "r"); or something similar. Also it might have Connector message. */
-          if (strncmp(file_name + 1, "Error: ", sizeof("Error: ") - 1) == 0)
+          /* pgoptionfiles_copy_from_tracee() peeks one word past the last whole word, where '\0' is */
+          state.metrics.peekdata_calls+= copy_result / sizeof(size_t);
+          ++state.metrics.classified_stops;
+          if (is_metrics || (state.record_file != NULL))
+            state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+          /* From here on it's the canonical name, only the denial below needs copy_result of what's in the tracee */
+          char canonical_name[PATH_MAX];
+          const char *reported_name= file_name;
+          int reported_length= copy_result;
+          if (state.is_connector_message_seen == 1)
           {
-            strcat(error_list, file_name + 1);
-            retcode= -6;
-            break;
+#ifdef __x86_64__
+            int canonical_length= pgoptionfiles_canonical(&state, pid, (arg_number == 1) ? (int) registers.rdi : AT_FDCWD, file_name, canonical_name);
+#else
+            int canonical_length= pgoptionfiles_canonical(&state, pid, (arg_number == 1) ? (int) registers.ebx : AT_FDCWD, file_name, canonical_name);
+#endif
+            if (canonical_length > 0) { reported_name= canonical_name; reported_length= canonical_length; }
           }
-          if (strncmp(file_name + 1, "(Connector exit", sizeof("(Connector exit") - 1) == 0)
+          if (state.record_file != NULL)
           {
-            is_connector_message_seen= 0;
-            continue;
+            record.syscall_number= psi_entry_nr;
+            record.file_name_length= reported_length;
+            record.syscall_result= -ENOSYS; /* which is also what the kernel puts in rax at entry */
+            record.timestamp= state.timestamp;
+            memcpy(record_file_name, reported_name, reported_length);
+            is_record_pending= 1;
           }
-          else if (strncmp(file_name + 1, "(Connector ", sizeof("(Connector ") - 1) == 0)
+          if (state.profile != NULL) memcpy(state.profile->entry_detail, reported_name, reported_length + 1);
+          int file_name_result= pgoptionfiles_tracer_file_name_policy(&state, reported_name, is_read);
+          if (file_name_result == PGOPTIONFILES_FILE_NAME_STOP) break;
+          if ((is_read == 0) && (file_name_result == PGOPTIONFILES_FILE_NAME_OPTION_FILE))
           {
-            strcat(error_list, file_name + 1);
-            is_connector_message_seen= 1;
-            continue;
-          }
-          /* option files normally are named my.cnf or .my.cnf but I've seen mysql.cnf and even mysqldump.cnf + don't forget .mylogin.cnf */
-          /* also let's not ignore non-configuration files like openssl.cnf */
-          /* but until we've seen "(Connector ..." we can assume any file accesses are for tracee maintenance dlopen etc. so skip them */
-          if (is_connector_message_seen == 0) continue;
-          int file_name_length= strlen(file_name);
-#if (PGOPTIONFILES_READ == 0)
-          /* Default option files will end with ".cnf" although !include files might not */
-          if ((file_name_length > 4) && (strcmp(file_name + file_name_length - 4, ".cnf") != 0)) continue;
-          /* Change filename's register to point to the trailing '\0' so the pass is empty string causing ENOENT. */
+            /* Change filename's register to point to the trailing '\0' so the pass is empty string causing ENOENT. */
 #ifdef __x86_64__
-          if (arg_number == 1) registers.rsi+= file_name_length;
-          else registers.rdi+= file_name_length;
+            if (arg_number == 1) registers.rsi+= copy_result;
+            else registers.rdi+= copy_result;
 #else
-          if (arg_number == 1) registers.ecx+= file_name_length;
-          else registers.ebx+= file_name_length;
-#endif
-          ptrace(PTRACE_SETREGS, pid, 0, &registers);
+            if (arg_number == 1) registers.ecx+= copy_result;
+            else registers.ebx+= copy_result;
 #endif
-          file_name[file_name_length]= PGOPTIONFILES_DELIMITER;
-          file_name[file_name_length + 1]= '\0';
-          const char *strstrx= strstr(file_names_list, file_name);
-          if (strstrx != NULL) continue; /* ignore duplicate file name */
-          if (strlen(file_names_list) + strlen(file_name) >= PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE) break; /* overflow check */
-          strcat(file_names_list, file_name);
+            ptrace(PTRACE_SETREGS, pid, 0, &registers);
+            if (state.last_entry_number >= 0) file_names_list->entries[state.last_entry_number].is_denied= 1;
+          }
         }
       }
     }
   }
-  /* Eliminate initial or duplicate or trail delimiters */
+  if (sync_fd >= 0) close(sync_fd);
+  if (is_tracee_ended == 0)
   {
-    int i_in= 0;
-    int i_out= 0;
-    for (;;)
-    {
-      char c= file_names_list[i_in++];
-      if (c == '\0') break;
-      if (c == '\0') { file_names_list[i_out]= '\0'; break; }
-      if (file_names_list[i_in] == '\0') { file_names_list[i_out]= '\0'; break; }
-      if (c != PGOPTIONFILES_DELIMITER) { file_names_list[i_out++]= c; continue; }
-      if (i_out == 0) continue;
-      if (file_names_list[i_in] == PGOPTIONFILES_DELIMITER) continue;
-      file_names_list[i_out++]= c;
-    }
+    /* Stopped early e.g. because of "Error: " message. EXITKILL would do this when we exit, but callers may not exit. */
+    kill(pid, SIGKILL);
+    while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR)) {;}
   }
-  return retcode;
+  if (is_record_pending == 1) pgoptionfiles_record_write(&state, &record, record_file_name);
+  pgoptionfiles_record_close(&state);
+  state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+  pgoptionfiles_tracer_finish(&state);
+  free(state.profile);
+  return state.retcode;
 }
 
-/*
-  Pass: syscall number
-  Return: -1 not relevant, 0 filename is arg0, 1 filename is arg1
-  See https://chromium.googlesource.com/chromiumos/docs/+/master/constants/syscalls.md
-  for separate lists of 32-bit and 64-bit syscalls.
-  Care about syscalls that have a const char *filename arg and look relevant.
-  Hope that a future Linux doesn't introduce a new call that would be relevant.
-  The #define SYS_... lines are brought in by #include <sys/syscalls.h> in pgoptionfiles.h.
-*/
-int pgoptionfiles_tracer_arg_number(size_t psi_entry_nr)
+#define PGOPTIONFILES_TRACER_VARIANT(is_read, is_timeout) \
+static int pgoptionfiles_tracer_ ## is_read ## _ ## is_timeout(pid_t pid, int sync_fd, struct pgoptionfiles_list *file_names_list, \
+                                                               char *error_list, const struct pgoptionfiles_options *options) \
+{ \
+  return pgoptionfiles_tracer_policy(pid, sync_fd, file_names_list, error_list, options, is_read, is_timeout); \
+}
+PGOPTIONFILES_TRACER_VARIANT(0, 0)
+PGOPTIONFILES_TRACER_VARIANT(0, 1)
+PGOPTIONFILES_TRACER_VARIANT(1, 0)
+PGOPTIONFILES_TRACER_VARIANT(1, 1)
+
+/* Pass: the seized tracee etc. Do: trace it with the variant for options' --read and --timeout. */
+int pgoptionfiles_tracer(pid_t pid, int sync_fd, struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
 {
-  if ((psi_entry_nr == SYS_open)      /* both 32-bit and 64-bit, arg0 */
-   || (psi_entry_nr == SYS_access)
-   || (psi_entry_nr == SYS_lstat)
-   || (psi_entry_nr == SYS_stat))
-    return 0;
-  if ((psi_entry_nr == SYS_openat)    /* both 32-bit and 64-bit, arg1 */
-   || (psi_entry_nr == SYS_faccessat))
-    return 1;
-#ifdef __x86_64__
-  if (psi_entry_nr == SYS_newfstatat) /* 64-bit, arg1 */
-    return 1;
-#else
-  if ((psi_entry_nr == SYS_stat64)    /* 32-bit, arg0 */
-   || (psi_entry_nr == SYS_lstat64))
-    return 0;
-  if (psi_entry_nr == SYS_fstatat64)  /* 32-bit, arg1 */
-    return 1;
-#endif
-  return -1;                          /* apparently not relevant */
+  static int (*const variants[2][2])(pid_t, int, struct pgoptionfiles_list *, char *, const struct pgoptionfiles_options *)=
+  {
+    {pgoptionfiles_tracer_0_0, pgoptionfiles_tracer_0_1},
+    {pgoptionfiles_tracer_1_0, pgoptionfiles_tracer_1_1}
+  };
+  return variants[options->is_read != 0][options->is_timeout != 0](pid, sync_fd, file_names_list, error_list, options);
+}
+
+/* If --record: open the file and write the magic. Return: 0 ok, -7 error (which is also in state->retcode) */
+int pgoptionfiles_record_open(struct pgoptionfiles_state *state)
+{
+  if (state->options->record_file_name == NULL) return 0;
+  state->record_file= fopen(state->options->record_file_name, "wb");
+  if (state->record_file == NULL)
+  {
+    strcat(state->error_list, "Error: cannot open --record file.");
+    state->retcode= -7;
+    return -7;
+  }
+  setvbuf(state->record_file, NULL, _IOFBF, 65536);
+  fwrite(PGOPTIONFILES_RECORD_MAGIC, 1, sizeof(PGOPTIONFILES_RECORD_MAGIC) - 1, state->record_file);
+  return 0;
+}
+
+void pgoptionfiles_record_write(struct pgoptionfiles_state *state, const struct pgoptionfiles_record *record, const char *file_name)
+{
+  fwrite(record, sizeof(*record), 1, state->record_file);
+  fwrite(file_name, 1, record->file_name_length, state->record_file);
+}
+
+void pgoptionfiles_record_close(struct pgoptionfiles_state *state)
+{
+  if (state->record_file == NULL) return;
+  if (fclose(state->record_file) != 0)
+  {
+    strcat(state->error_list, "Error: cannot write --record file.");
+    if (state->retcode == 0) state->retcode= -7;
+  }
+  state->record_file= NULL;
+}
+
+/* Return: nanoseconds since start, CLOCK_MONOTONIC, which is a vDSO call so it's cheap but not free */
+int64_t pgoptionfiles_nanoseconds_since(const struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) (now.tv_sec - start->tv_sec) * 1000000000 + (now.tv_nsec - start->tv_nsec);
 }
-#endif
 
-#if (PGOPTIONFILES_TRACEE_ONLY == 0)
 /*
-  Pass: a tracee address, taken from an arg of the syscall, e.g. (char*) psi.entry.args[1]
-  Do: make a copy as far as '\0' in a tracer string, e.g. file_name
-  Return: -1 if unexpected error, or # of bytes 
-  This is not the most efficient way to copy but it is the shortest code.
-  PTRACE_PEEKDATA needs a "word", I'm assuming that's size_t so 4 bytes in 32-bit or 8-bits in 64-bit
-  (elsewhere the test is #ifdef __x86_64__)
+  Pass: a file name which the tracee passed to a relevant syscall (live or from a --record file)
+  Do: look for tracee messages, then filter, then add to file_names_list if it's not a duplicate
+      (if it's added, state->last_entry_number is its entry number so the caller can fill in more)
+  Return: PGOPTIONFILES_FILE_NAME_IGNORE, or
+          PGOPTIONFILES_FILE_NAME_OPTION_FILE i.e. if not --read the caller should make the syscall fail, or
+          PGOPTIONFILES_FILE_NAME_STOP i.e. caller should stop, state->retcode says why
 */
-int pgoptionfiles_copy_from_tracee(pid_t tracee_pid, char *dest, const char *src)
+static inline __attribute__((always_inline))
+int pgoptionfiles_tracer_file_name_policy(struct pgoptionfiles_state *state, const char *file_name, const int is_read)
 {
-  if (src == NULL) return 0;
-  int dest_offset= 0;
-  for (int word_number= 0;; ++word_number)
+  /* if tracee has an error it calls fopen("Error: ...", "r"); or something similar. Also it might have Connector message. */
+  if (strncmp(file_name, "Error: ", sizeof("Error: ") - 1) == 0)
+  {
+    strcat(state->error_list, file_name);
+    state->retcode= -6;
+    return PGOPTIONFILES_FILE_NAME_STOP;
+  }
+  if (strncmp(file_name, "(Connector exit", sizeof("(Connector exit") - 1) == 0)
+  {
+    state->is_connector_message_seen= 0;
+    return PGOPTIONFILES_FILE_NAME_IGNORE;
+  }
+  else if (strncmp(file_name, "(Connector phase ", sizeof("(Connector phase ") - 1) == 0)
+  {
+    const char *phase_name= file_name + sizeof("(Connector phase ") - 1;
+    for (int phase= PGOPTIONFILES_PHASE_OPTIONS; phase < PGOPTIONFILES_PHASE_COUNT; ++phase)
+      if (strcmp(phase_name, pgoptionfiles_phase_names[phase]) == 0) pgoptionfiles_tracer_phase(state, phase);
+    return PGOPTIONFILES_FILE_NAME_IGNORE;
+  }
+  else if (strncmp(file_name, "(Connector query ", sizeof("(Connector query ") - 1) == 0)
+  {
+    struct pgoptionfiles_list *list= state->file_names_list;
+    if (list->query_count == PGOPTIONFILES_MAX_QUERIES) return PGOPTIONFILES_FILE_NAME_IGNORE; /* can't happen */
+    snprintf(list->query_labels[list->query_count], PGOPTIONFILES_QUERY_LABEL_SIZE, "%s", file_name + sizeof("(Connector query ") - 1);
+    pgoptionfiles_list_stream(list, list->query_labels[list->query_count]);
+    list->query_number= list->query_count++;
+    pgoptionfiles_tracer_phase(state, PGOPTIONFILES_PHASE_OPTIONS);
+    return PGOPTIONFILES_FILE_NAME_IGNORE;
+  }
+  else if (strncmp(file_name, "(Connector ", sizeof("(Connector ") - 1) == 0)
+  {
+    strcat(state->error_list, file_name);
+    state->is_connector_message_seen= 1;
+    pgoptionfiles_tracer_phase(state, PGOPTIONFILES_PHASE_OPTIONS);
+    return PGOPTIONFILES_FILE_NAME_IGNORE;
+  }
+  /* option files normally are named my.cnf or .my.cnf but I've seen mysql.cnf and even mysqldump.cnf + don't forget .mylogin.cnf */
+  /* also let's not ignore non-configuration files like openssl.cnf */
+  /* but until we've seen "(Connector ..." we can assume any file accesses are for tracee maintenance dlopen etc. so skip them */
+  if (state->is_connector_message_seen == 0) return PGOPTIONFILES_FILE_NAME_IGNORE;
+  int file_name_length= strlen(file_name);
+  /* Default option files will end with ".cnf" although !include files might not */
+  if ((is_read == 0) && (file_name_length > 3) && (strcmp(file_name + file_name_length - 4, ".cnf") != 0)) return PGOPTIONFILES_FILE_NAME_IGNORE;
+  pgoptionfiles_list_stream(state->file_names_list, NULL); /* the previous entry's syscall has ended */
+  int entry_number= pgoptionfiles_list_add(state->file_names_list, file_name, file_name_length);
+  PGOPTIONFILES_PROBE2(dedup, file_name, entry_number);
+  if (entry_number == -1) { ++state->metrics.dedup_hits; return PGOPTIONFILES_FILE_NAME_OPTION_FILE; } /* ignore duplicate file name */
+  if (entry_number < 0) return PGOPTIONFILES_FILE_NAME_STOP; /* overflow */
+  state->last_entry_number= entry_number;
+  ++state->metrics.file_names;
+  return PGOPTIONFILES_FILE_NAME_OPTION_FILE;
+}
+
+/* pgoptionfiles_tracer_file_name_policy() for the other backends and replay, which aren't per-stop hot loops */
+int pgoptionfiles_tracer_file_name(struct pgoptionfiles_state *state, const char *file_name)
+{
+  return pgoptionfiles_tracer_file_name_policy(state, file_name, state->options->is_read);
+}
+
+/* Tracee phase change, state->timestamp is when, the time since the previous change goes to the previous phase */
+void pgoptionfiles_tracer_phase(struct pgoptionfiles_state *state, int phase)
+{
+  PGOPTIONFILES_PROBE2(phase, state->phase, phase);
+  if (state->perf != NULL) pgoptionfiles_perf_phase(state);
+  state->metrics.phase_nanoseconds[state->phase]+= state->timestamp - state->phase_start;
+  state->phase= phase;
+  state->phase_start= state->timestamp;
+}
+
+/* End of pgoptionfiles_tracer() or pgoptionfiles_replay(), state->timestamp is the end time. Maybe print --metrics. */
+void pgoptionfiles_tracer_finish(struct pgoptionfiles_state *state)
+{
+  pgoptionfiles_list_stream(state->file_names_list, NULL);
+  pgoptionfiles_tracer_phase(state, state->phase);
+  state->metrics.trace_nanoseconds= state->timestamp;
+  if (state->options->metrics_format != NULL) pgoptionfiles_metrics_print(state, stderr);
+  if (state->options->metrics_result != NULL) *state->options->metrics_result= state->metrics;
+  if (state->profile != NULL) pgoptionfiles_profile_print(state, stderr);
+  if (state->perf != NULL) pgoptionfiles_perf_print(state, stderr);
+  pgoptionfiles_perf_close(state);
+  free(state->fd_cache);
+  state->fd_cache= NULL;
+}
+
+/*
+  Pass: options with replay_file_name = a file that --record wrote
+  Do: what pgoptionfiles_tracer() does with file names, but there is no tracee
+  Return: same as pgoptionfiles_tracer()
+*/
+int pgoptionfiles_replay(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_state state;
+  memset(&state, 0, sizeof(state));
+  state.options= options;
+  state.file_names_list= file_names_list;
+  state.last_entry_number= -1;
+  state.error_list= error_list;
+  FILE *replay_file= fopen(options->replay_file_name, "rb");
+  if (replay_file == NULL)
+  {
+    strcat(error_list, "Error: cannot open --replay file.");
+    return -7;
+  }
+  setvbuf(replay_file, NULL, _IOFBF, 65536);
+  int is_attach_record= 0; /* 1 if made with --pid, see pgoptionfiles_attach() */
+  char magic[sizeof(PGOPTIONFILES_RECORD_MAGIC) - 1];
+  if ((fread(magic, 1, sizeof(magic), replay_file) != sizeof(magic))
+   || (memcmp(magic, PGOPTIONFILES_RECORD_MAGIC, sizeof(magic)) != 0))
+  {
+    fclose(replay_file);
+    strcat(error_list, "Error: --replay file was not made by --record.");
+    return -7;
+  }
+  pgoptionfiles_perf_open(&state, 0);
+  for (;;)
+  {
+    struct pgoptionfiles_record record;
+    char file_name[PATH_MAX];
+    size_t fread_result= fread(&record, 1, sizeof(record), replay_file);
+    if (fread_result == 0) break; /* end of file, the usual way to finish */
+    if ((fread_result != sizeof(record))
+     || (record.file_name_length >= PATH_MAX)
+     || (fread(file_name, 1, record.file_name_length, replay_file) != record.file_name_length))
+    {
+      strcat(error_list, "Error: --replay file is truncated or corrupt.");
+      state.retcode= -7;
+      break;
+    }
+    file_name[record.file_name_length]= '\0';
+    state.timestamp= record.timestamp;
+    /* The tracer only records what pgoptionfiles_tracer_arg_number() accepted, but check in case of a different build */
+    if (pgoptionfiles_tracer_arg_number(record.syscall_number) < 0) continue;
+    ++state.metrics.classified_stops;
+    if (strncmp(file_name, "(Connector pid ", sizeof("(Connector pid ") - 1) == 0)
+    {
+      sprintf(error_list + strlen(error_list), "(%.40s", file_name + sizeof("(Connector ") - 1);
+      state.is_connector_message_seen= 1;
+      is_attach_record= 1;
+      continue;
+    }
+    int file_name_result= pgoptionfiles_tracer_file_name(&state, file_name);
+    if (file_name_result == PGOPTIONFILES_FILE_NAME_STOP) break;
+    if (state.last_entry_number >= 0)
+    {
+      file_names_list->entries[state.last_entry_number].syscall_result= record.syscall_result;
+      file_names_list->entries[state.last_entry_number].is_denied= (options->is_read == 0) && (is_attach_record == 0);
+      state.last_entry_number= -1;
+    }
+  }
+  fclose(replay_file);
+  pgoptionfiles_tracer_finish(&state);
+  return state.retcode;
+}
+
+/*
+  Pass: syscall number
+  Return: -1 not relevant, 0 filename is arg0, 1 filename is arg1
+  See https://chromium.googlesource.com/chromiumos/docs/+/master/constants/syscalls.md
+  for separate lists of 32-bit and 64-bit syscalls.
+  Care about syscalls that have a const char *filename arg and look relevant.
+  Hope that a future Linux doesn't introduce a new call that would be relevant.
+  The #define SYS_... lines are brought in by #include <sys/syscalls.h> in pgoptionfiles.h.
+*/
+int pgoptionfiles_tracer_arg_number(size_t psi_entry_nr)
+{
+  if ((psi_entry_nr == SYS_open)      /* both 32-bit and 64-bit, arg0 */
+   || (psi_entry_nr == SYS_access)
+   || (psi_entry_nr == SYS_lstat)
+   || (psi_entry_nr == SYS_stat))
+    return 0;
+  if ((psi_entry_nr == SYS_openat)    /* both 32-bit and 64-bit, arg1 */
+   || (psi_entry_nr == SYS_faccessat))
+    return 1;
+#ifdef __x86_64__
+  if (psi_entry_nr == SYS_newfstatat) /* 64-bit, arg1 */
+    return 1;
+#else
+  if ((psi_entry_nr == SYS_stat64)    /* 32-bit, arg0 */
+   || (psi_entry_nr == SYS_lstat64))
+    return 0;
+  if (psi_entry_nr == SYS_fstatat64)  /* 32-bit, arg1 */
+    return 1;
+#endif
+  return -1;                          /* apparently not relevant */
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  Pass: a tracee address, taken from an arg of the syscall, e.g. (char*) psi.entry.args[1]
+  Do: make a copy as far as '\0' in a tracer string, e.g. file_name
+  Return: -1 if unexpected error, or # of bytes 
+  This is not the most efficient way to copy but it is the shortest code.
+  PTRACE_PEEKDATA needs a "word", I'm assuming that's size_t so 4 bytes in 32-bit or 8-bits in 64-bit
+  (elsewhere the test is #ifdef __x86_64__)
+*/
+int pgoptionfiles_copy_from_tracee(pid_t tracee_pid, char *dest, const char *src)
+{
+  PGOPTIONFILES_PROBE2(copy_start, tracee_pid, src);
+  if (src == NULL) { PGOPTIONFILES_PROBE2(copy_done, tracee_pid, 0); return 0; }
+  int dest_offset= 0;
+  for (int word_number= 0;; ++word_number)
   {
     size_t word= 0;
     uint8_t c= '\0';
@@ -509,6 +1580,4103 @@ int pgoptionfiles_copy_from_tracee(pid_t tracee_pid, char *dest, const char *src
     if (c == '\0') break;
   }
   *(dest + dest_offset)= '\0';
+  PGOPTIONFILES_PROBE2(copy_done, tracee_pid, dest_offset);
   return dest_offset;
 }
 #endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* CANONICAL PATHS ***************
+  The tracee passes file names however it likes: relative to a directory fd (openat(fd, "my.cnf", ...)), relative
+  to its current directory, or absolute but with // or /./ or /../ in them. So one file could be listed under
+  several names, since the list's dedup is plain string comparison, and a caller would need realpath() to compare.
+  pgoptionfiles_canonical() makes the name absolute and normalized before it's classified. A relative name's
+  directory comes from readlink() of /proc/PID/fd/N or /proc/PID/cwd, then empty and "." components are removed.
+  ".." components stay as they are: taking one off with the component before it would be wrong if that is a
+  symbolic link (conf.d -> /opt/x, conf.d/../my.cnf is /opt/my.cnf), and symbolic links are not followed --
+  the name is what the tracee asked for, not what it got. So a name with ".." still names the file it opened.
+  readlink() says where the directory is for the tracer, so the tracee's root (/proc/PID/root, i.e. DIR if
+  --root DIR) is taken off the front, and names match the absolute names that the tracee passes.
+  If the backend sees every syscall, i.e. the ptrace tracer or --pid, state->fd_cache keeps directory names
+  per fd, and pgoptionfiles_fd_cache_syscall() forgets one when close() or dup2() or chdir() etc. changes it.
+  Otherwise (--backend seccomp or dlmopen) there's no cache and each relative name costs a readlink().
+  Tracee messages are left alone, and callers don't bother before "(Connector ..." since names are ignored then.
+*/
+
+/*
+  Pass: tracee pid, directory fd or AT_FDCWD, directory_name buffer of PATH_MAX
+  Do: readlink() the directory's name, without the tracee's root
+  Return: length, or -1 if it's not a directory name (e.g. "pipe:[1234]") or it's gone
+*/
+static int pgoptionfiles_canonical_directory(pid_t pid, int directory_fd, char *directory_name)
+{
+  char proc_name[64];
+  char root_name[PATH_MAX];
+  if (directory_fd == AT_FDCWD) sprintf(proc_name, "/proc/%d/cwd", (int) pid);
+  else sprintf(proc_name, "/proc/%d/fd/%d", (int) pid, directory_fd);
+  ssize_t length= readlink(proc_name, directory_name, PATH_MAX - 1);
+  if ((length <= 0) || (directory_name[0] != '/')) return -1;
+  directory_name[length]= '\0';
+  if ((length > 10) && (strcmp(directory_name + length - 10, " (deleted)") == 0)) return -1;
+  sprintf(proc_name, "/proc/%d/root", (int) pid);
+  ssize_t root_length= readlink(proc_name, root_name, sizeof(root_name) - 1);
+  if (root_length > 1) /* i.e. not "/" */
+  {
+    if ((length < root_length) || (memcmp(directory_name, root_name, root_length) != 0)
+     || ((directory_name[root_length] != '/') && (directory_name[root_length] != '\0')))
+      return -1; /* outside its root, e.g. an fd opened before chroot() */
+    length-= root_length;
+    memmove(directory_name, directory_name + root_length, length + 1);
+    if (length == 0) { strcpy(directory_name, "/"); length= 1; }
+  }
+  return length;
+}
+
+/*
+  Pass: state, tracee pid (a thread id is okay), the syscall's directory fd (AT_FDCWD for open(), access() etc.),
+        file name from the tracee, canonical_name buffer of PATH_MAX
+  Do: make canonical_name, the absolute normalized name, as described above
+  Return: its length, or 0 if file_name should be used as it is (a tracee message, or the directory is unknown)
+*/
+int pgoptionfiles_canonical(struct pgoptionfiles_state *state, pid_t pid, int directory_fd, const char *file_name, char *canonical_name)
+{
+  char joined_name[PATH_MAX * 2];
+  size_t joined_length= 0;
+  if ((file_name[0] == '\0')
+   || (strncmp(file_name, "Error: ", sizeof("Error: ") - 1) == 0)
+   || (strncmp(file_name, "(Connector ", sizeof("(Connector ") - 1) == 0))
+    return 0;
+  if (file_name[0] != '/')
+  {
+    struct pgoptionfiles_fd_cache *fd_cache= state->fd_cache;
+    unsigned int i= 0;
+    if (fd_cache != NULL)
+      while ((i < fd_cache->count) && (fd_cache->fds[i] != directory_fd)) ++i;
+    if ((fd_cache != NULL) && (i < fd_cache->count))
+    {
+      joined_length= strlen(fd_cache->directory_names[i]);
+      memcpy(joined_name, fd_cache->directory_names[i], joined_length);
+    }
+    else
+    {
+      ++state->metrics.directory_lookups;
+      int length= pgoptionfiles_canonical_directory(pid, directory_fd, joined_name);
+      if (length < 0) return 0;
+      joined_length= length;
+      if (fd_cache != NULL)
+      {
+        if (fd_cache->count < PGOPTIONFILES_FD_CACHE_SIZE) i= fd_cache->count++;
+        else i= fd_cache->next++ % PGOPTIONFILES_FD_CACHE_SIZE;
+        fd_cache->fds[i]= directory_fd;
+        memcpy(fd_cache->directory_names[i], joined_name, joined_length + 1);
+      }
+    }
+    joined_name[joined_length++]= '/';
+  }
+  size_t file_name_length= strlen(file_name);
+  if (joined_length + file_name_length >= sizeof(joined_name)) return 0;
+  memcpy(joined_name + joined_length, file_name, file_name_length + 1);
+  /* Each component is appended after a '/', except "" and "." are skipped. ".." stays, see above. */
+  size_t canonical_length= 0;
+  for (const char *component= joined_name; *component != '\0';)
+  {
+    while (*component == '/') ++component;
+    size_t component_length= strcspn(component, "/");
+    if ((component_length == 0) || ((component_length == 1) && (component[0] == '.'))) {;}
+    else
+    {
+      if (canonical_length + 1 + component_length >= PATH_MAX) return 0;
+      canonical_name[canonical_length++]= '/';
+      memcpy(canonical_name + canonical_length, component, component_length);
+      canonical_length+= component_length;
+    }
+    component+= component_length;
+  }
+  if (canonical_length == 0) canonical_name[canonical_length++]= '/';
+  canonical_name[canonical_length]= '\0';
+  return canonical_length;
+}
+
+/*
+  Pass: state, syscall number and its first two args, at syscall entry
+  Do: if state->fd_cache: forget what this syscall could change. Cheap if there's nothing cached.
+*/
+void pgoptionfiles_fd_cache_syscall(struct pgoptionfiles_state *state, size_t syscall_number, long arg0, long arg1)
+{
+  struct pgoptionfiles_fd_cache *fd_cache= state->fd_cache;
+  int fd;
+  if ((fd_cache == NULL) || (fd_cache->count == 0)) return;
+  if (syscall_number == SYS_close) fd= (int) arg0;
+#ifdef SYS_dup2
+  else if (syscall_number == SYS_dup2) fd= (int) arg1;
+#endif
+  else if (syscall_number == SYS_dup3) fd= (int) arg1;
+  else if ((syscall_number == SYS_chdir) || (syscall_number == SYS_fchdir)) fd= AT_FDCWD;
+  else if ((syscall_number == SYS_execve)
+#ifdef SYS_close_range
+        || (syscall_number == SYS_close_range)
+#endif
+        || (syscall_number == SYS_unshare)
+        || (syscall_number == SYS_chroot))
+  {
+    fd_cache->count= 0; /* too many possibilities, start again */
+    return;
+  }
+  else return;
+  for (unsigned int i= 0; i < fd_cache->count; ++i)
+  {
+    if (fd_cache->fds[i] != fd) continue;
+    --fd_cache->count;
+    fd_cache->fds[i]= fd_cache->fds[fd_cache->count];
+    strcpy(fd_cache->directory_names[i], fd_cache->directory_names[fd_cache->count]);
+    break;
+  }
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* METRICS ***************
+  Counters are always kept because increments are cheap. Times need clock_gettime() so they're only kept if --metrics.
+*/
+
+const char *pgoptionfiles_phase_names[PGOPTIONFILES_PHASE_COUNT]= {"load", "options", "connect", "close"};
+
+/* Print a string for a JSON string or a Prometheus label value, both of which are inside "" and need \ escapes */
+static void pgoptionfiles_metrics_print_escaped(FILE *fp, const char *s, int is_json)
+{
+  for (; *s != '\0'; ++s)
+  {
+    unsigned char c= (unsigned char) *s;
+    if ((c == '"') || (c == '\\')) fprintf(fp, "\\%c", c);
+    else if (c == '\n') fprintf(fp, "\\n");
+    else if ((c < 0x20) && is_json) fprintf(fp, "\\u%04x", c);
+    else fputc(c, fp);
+  }
+}
+
+/*
+  Pass: state at end of trace or replay, where to print
+  Do: print counters and times as JSON (one object, one line) or Prometheus text exposition format.
+  With --replay, syscall_stops and peekdata and waitpid are 0 because only classified stops were recorded.
+*/
+void pgoptionfiles_metrics_print(const struct pgoptionfiles_state *state, FILE *fp)
+{
+  const struct pgoptionfiles_metrics *m= &state->metrics;
+  const char *library_name= state->options->library_name;
+  char pid_label[32];
+  if (library_name == NULL) library_name= state->options->replay_file_name;
+  if (library_name == NULL) { sprintf(pid_label, "pid %d", (int) state->options->attach_pid); library_name= pid_label; }
+  if (strcmp(state->options->metrics_format, "json") == 0)
+  {
+    fprintf(fp, "{\"library\":\"");
+    pgoptionfiles_metrics_print_escaped(fp, library_name, 1);
+    fprintf(fp, "\",\"retcode\":%d,\"syscall_stops\":%llu,\"classified_stops\":%llu,"
+                "\"peekdata_calls\":%llu,\"peekdata_bytes\":%llu,\"dedup_hits\":%llu,\"file_names\":%llu,"
+                "\"directory_lookups\":%llu,\"waitpid_seconds\":%.9f,\"trace_seconds\":%.9f,\"phase_seconds\":{",
+            state->retcode, m->syscall_stops, m->classified_stops,
+            m->peekdata_calls, m->peekdata_calls * sizeof(size_t), m->dedup_hits, m->file_names, m->directory_lookups,
+            m->waitpid_nanoseconds / 1e9, m->trace_nanoseconds / 1e9);
+    for (int phase= 0; phase < PGOPTIONFILES_PHASE_COUNT; ++phase)
+      fprintf(fp, "%s\"%s\":%.9f", (phase == 0) ? "" : ",", pgoptionfiles_phase_names[phase], m->phase_nanoseconds[phase] / 1e9);
+    fprintf(fp, "}}\n");
+    return;
+  }
+  const struct { const char *name; const char *type; const char *help; double value; } items[]=
+  {
+    {"syscall_stops_total", "counter", "Syscall entry and exit stops seen by the tracer.", (double) m->syscall_stops},
+    {"classified_stops_total", "counter", "Syscall entry stops with a file name argument.", (double) m->classified_stops},
+    {"peekdata_calls_total", "counter", "PTRACE_PEEKDATA calls to copy file names.", (double) m->peekdata_calls},
+    {"peekdata_bytes_total", "counter", "Bytes copied by PTRACE_PEEKDATA.", (double) (m->peekdata_calls * sizeof(size_t))},
+    {"dedup_hits_total", "counter", "Option file names ignored because they were already in the list.", (double) m->dedup_hits},
+    {"file_names", "gauge", "Option file names in the list.", (double) m->file_names},
+    {"directory_lookups_total", "counter", "readlink() of /proc/PID/fd/N or cwd to make relative names absolute.", (double) m->directory_lookups},
+    {"waitpid_seconds_total", "counter", "Time the tracer was blocked in waitpid().", m->waitpid_nanoseconds / 1e9},
+    {"trace_seconds", "gauge", "Time from start to end of trace.", m->trace_nanoseconds / 1e9},
+    {"retcode", "gauge", "Return code, 0 means success.", (double) state->retcode},
+  };
+  for (unsigned int i= 0; i < sizeof(items) / sizeof(items[0]); ++i)
+  {
+    fprintf(fp, "# HELP pgoptionfiles_%s %s\n# TYPE pgoptionfiles_%s %s\npgoptionfiles_%s{library=\"",
+            items[i].name, items[i].help, items[i].name, items[i].type, items[i].name);
+    pgoptionfiles_metrics_print_escaped(fp, library_name, 0);
+    fprintf(fp, "\"} %.9g\n", items[i].value);
+  }
+  fprintf(fp, "# HELP pgoptionfiles_phase_seconds Time in each tracee phase.\n# TYPE pgoptionfiles_phase_seconds gauge\n");
+  for (int phase= 0; phase < PGOPTIONFILES_PHASE_COUNT; ++phase)
+  {
+    fprintf(fp, "pgoptionfiles_phase_seconds{library=\"");
+    pgoptionfiles_metrics_print_escaped(fp, library_name, 0);
+    fprintf(fp, "\",phase=\"%s\"} %.9f\n", pgoptionfiles_phase_names[phase], m->phase_nanoseconds[phase] / 1e9);
+  }
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* PROFILE ***************
+  --profile. At each syscall entry stop the tracer notes the time, at the exit stop it adds the difference to
+  counts[phase][syscall] and nanoseconds[phase][syscall], and keeps the slowest few with what they were about.
+  The phase is the one at entry, so a "(Connector phase ..." message's own fopen() counts in the phase it ends.
+*/
+
+/* Return: syscall name for the ones a connector is likely to do, else NULL */
+static const char *pgoptionfiles_profile_syscall_name(size_t syscall_number)
+{
+  switch (syscall_number)
+  {
+#ifdef SYS_open
+  case SYS_open: return "open";
+#endif
+#ifdef SYS_stat
+  case SYS_stat: return "stat";
+#endif
+#ifdef SYS_lstat
+  case SYS_lstat: return "lstat";
+#endif
+#ifdef SYS_access
+  case SYS_access: return "access";
+#endif
+#ifdef SYS_readlink
+  case SYS_readlink: return "readlink";
+#endif
+#ifdef SYS_mmap
+  case SYS_mmap: return "mmap";
+#endif
+#ifdef SYS_mmap2
+  case SYS_mmap2: return "mmap2";
+#endif
+#ifdef SYS_fstat
+  case SYS_fstat: return "fstat";
+#endif
+#ifdef SYS_socket
+  case SYS_socket: return "socket";
+  case SYS_connect: return "connect";
+  case SYS_sendto: return "sendto";
+  case SYS_recvfrom: return "recvfrom";
+  case SYS_sendmsg: return "sendmsg";
+  case SYS_recvmsg: return "recvmsg";
+  case SYS_setsockopt: return "setsockopt";
+  case SYS_getsockopt: return "getsockopt";
+  case SYS_getsockname: return "getsockname";
+  case SYS_bind: return "bind";
+#endif
+#ifdef SYS_poll
+  case SYS_poll: return "poll";
+#endif
+#ifdef SYS_select
+  case SYS_select: return "select";
+#endif
+#ifdef SYS_getdents64
+  case SYS_getdents64: return "getdents64";
+#endif
+#ifdef SYS_newfstatat
+  case SYS_newfstatat: return "newfstatat";
+#endif
+#ifdef SYS_fstatat64
+  case SYS_fstatat64: return "fstatat64";
+#endif
+  case SYS_read: return "read";
+  case SYS_write: return "write";
+  case SYS_close: return "close";
+  case SYS_lseek: return "lseek";
+  case SYS_pread64: return "pread64";
+  case SYS_munmap: return "munmap";
+  case SYS_mprotect: return "mprotect";
+  case SYS_brk: return "brk";
+  case SYS_ioctl: return "ioctl";
+  case SYS_fcntl: return "fcntl";
+  case SYS_openat: return "openat";
+  case SYS_faccessat: return "faccessat";
+  case SYS_statx: return "statx";
+  case SYS_getrandom: return "getrandom";
+  case SYS_futex: return "futex";
+  case SYS_uname: return "uname";
+  case SYS_getpid: return "getpid";
+  case SYS_getuid: return "getuid";
+  case SYS_geteuid: return "geteuid";
+  case SYS_rt_sigaction: return "rt_sigaction";
+  case SYS_rt_sigprocmask: return "rt_sigprocmask";
+  case SYS_clock_gettime: return "clock_gettime";
+  case SYS_exit_group: return "exit_group";
+  case SYS_ppoll: return "ppoll";
+  case SYS_pselect6: return "pselect6";
+  case SYS_madvise: return "madvise";
+  case SYS_sched_getaffinity: return "sched_getaffinity";
+  default: return NULL;
+  }
+}
+
+/* For connect(): "inet 1.2.3.4:3306" or "inet6 [::1]:53 (DNS)" or "unix /run/mysqld/mysqld.sock", from tracee memory */
+static void pgoptionfiles_profile_describe_address(pid_t pid, unsigned long address, size_t address_length, char *detail, size_t detail_size)
+{
+  union { struct sockaddr_storage storage; long words[sizeof(struct sockaddr_storage) / sizeof(long)]; } buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  if (address_length > sizeof(buffer)) address_length= sizeof(buffer);
+  for (size_t i= 0; i * sizeof(long) < address_length; ++i)
+  {
+    errno= 0;
+    buffer.words[i]= ptrace(PTRACE_PEEKDATA, pid, (void *) (address + i * sizeof(long)), NULL);
+    if (errno != 0) return;
+  }
+  char host[INET6_ADDRSTRLEN]= "";
+  unsigned int port= 0;
+  if (buffer.storage.ss_family == AF_INET)
+  {
+    const struct sockaddr_in *in= (const struct sockaddr_in *) &buffer.storage;
+    inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+    port= ntohs(in->sin_port);
+    snprintf(detail, detail_size, "inet %s:%u%s", host, port, (port == 53) ? " (DNS)" : "");
+  }
+  else if (buffer.storage.ss_family == AF_INET6)
+  {
+    const struct sockaddr_in6 *in6= (const struct sockaddr_in6 *) &buffer.storage;
+    inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+    port= ntohs(in6->sin6_port);
+    snprintf(detail, detail_size, "inet6 [%s]:%u%s", host, port, (port == 53) ? " (DNS)" : "");
+  }
+  else if (buffer.storage.ss_family == AF_UNIX)
+  {
+    const struct sockaddr_un *un= (const struct sockaddr_un *) &buffer.storage;
+    snprintf(detail, detail_size, "unix %.*s", (int) sizeof(un->sun_path), un->sun_path);
+  }
+}
+
+/* At syscall entry. Registers are already fetched. The caller adds the file name to entry_detail if there is one. */
+void pgoptionfiles_profile_entry(struct pgoptionfiles_state *state, pid_t pid, size_t syscall_number, const struct user_regs_struct *registers)
+{
+  struct pgoptionfiles_profile *profile= state->profile;
+  profile->entry_nanoseconds= pgoptionfiles_nanoseconds_since(&state->start_time);
+  profile->entry_syscall_number= syscall_number;
+  profile->entry_phase= state->phase;
+  profile->is_entry_pending= 1;
+  profile->entry_detail[0]= '\0';
+#if defined(__x86_64__) && defined(SYS_connect)
+  if (syscall_number == SYS_connect)
+    pgoptionfiles_profile_describe_address(pid, registers->rsi, registers->rdx, profile->entry_detail, sizeof(profile->entry_detail));
+#else
+  (void) pid; (void) registers;
+#endif
+}
+
+/* At syscall exit. An exit stop without an entry stop, e.g. the first stop after the seize, isn't counted. */
+void pgoptionfiles_profile_exit(struct pgoptionfiles_state *state)
+{
+  struct pgoptionfiles_profile *profile= state->profile;
+  if (profile->is_entry_pending == 0) return;
+  profile->is_entry_pending= 0;
+  int64_t nanoseconds= pgoptionfiles_nanoseconds_since(&state->start_time) - profile->entry_nanoseconds;
+  size_t syscall_number= profile->entry_syscall_number;
+  if (syscall_number >= PGOPTIONFILES_PROFILE_MAX_SYSCALL) syscall_number= PGOPTIONFILES_PROFILE_MAX_SYSCALL - 1; /* "other" */
+  ++profile->counts[profile->entry_phase][syscall_number];
+  profile->nanoseconds[profile->entry_phase][syscall_number]+= nanoseconds;
+  /* slowest[] is sorted slowest first, insert if slower than the last */
+  int i= PGOPTIONFILES_PROFILE_SLOWEST - 1;
+  if (nanoseconds <= profile->slowest[i].nanoseconds) return;
+  for (; (i > 0) && (nanoseconds > profile->slowest[i - 1].nanoseconds); --i) profile->slowest[i]= profile->slowest[i - 1];
+  profile->slowest[i].nanoseconds= nanoseconds;
+  profile->slowest[i].syscall_number= profile->entry_syscall_number;
+  profile->slowest[i].phase= profile->entry_phase;
+  strcpy(profile->slowest[i].detail, profile->entry_detail);
+}
+
+static void pgoptionfiles_profile_print_name(FILE *fp, size_t syscall_number)
+{
+  const char *name= pgoptionfiles_profile_syscall_name(syscall_number);
+  if (name != NULL) fprintf(fp, "%-18s", name);
+  else if (syscall_number == PGOPTIONFILES_PROFILE_MAX_SYSCALL - 1) fprintf(fp, "%-18s", "other");
+  else fprintf(fp, "syscall_%-10zu", syscall_number);
+}
+
+/*
+  (pgoptionfiles)(profile library-name)
+  phase    syscall               count    total_ms    mean_us
+  load     openat                   57       1.234      21.6
+  ...
+  (pgoptionfiles)(profile slowest)
+  ms       phase    syscall            detail
+*/
+void pgoptionfiles_profile_print(const struct pgoptionfiles_state *state, FILE *fp)
+{
+  const struct pgoptionfiles_profile *profile= state->profile;
+  fprintf(fp, "(pgoptionfiles)(profile %s)\n", (state->options->library_name != NULL) ? state->options->library_name : "");
+  fprintf(fp, "%-8s %-18s %8s %11s %10s\n", "phase", "syscall", "count", "total_ms", "mean_us");
+  for (int phase= 0; phase < PGOPTIONFILES_PHASE_COUNT; ++phase)
+  {
+    /* Selection sort by time, the table is small and this happens once */
+    char is_printed[PGOPTIONFILES_PROFILE_MAX_SYSCALL];
+    memset(is_printed, 0, sizeof(is_printed));
+    for (;;)
+    {
+      int busiest= -1;
+      for (int nr= 0; nr < PGOPTIONFILES_PROFILE_MAX_SYSCALL; ++nr)
+        if ((profile->counts[phase][nr] > 0) && (is_printed[nr] == 0)
+         && ((busiest < 0) || (profile->nanoseconds[phase][nr] > profile->nanoseconds[phase][busiest]))) busiest= nr;
+      if (busiest < 0) break;
+      is_printed[busiest]= 1;
+      fprintf(fp, "%-8s ", pgoptionfiles_phase_names[phase]);
+      pgoptionfiles_profile_print_name(fp, busiest);
+      fprintf(fp, " %8llu %11.3f %10.1f\n", profile->counts[phase][busiest], profile->nanoseconds[phase][busiest] / 1e6,
+              profile->nanoseconds[phase][busiest] / 1e3 / profile->counts[phase][busiest]);
+    }
+  }
+  fprintf(fp, "(pgoptionfiles)(profile slowest)\n");
+  fprintf(fp, "%-10s %-8s %-18s %s\n", "ms", "phase", "syscall", "detail");
+  for (int i= 0; (i < PGOPTIONFILES_PROFILE_SLOWEST) && (profile->slowest[i].nanoseconds > 0); ++i)
+  {
+    fprintf(fp, "%-10.3f %-8s ", profile->slowest[i].nanoseconds / 1e6, pgoptionfiles_phase_names[profile->slowest[i].phase]);
+    pgoptionfiles_profile_print_name(fp, profile->slowest[i].syscall_number);
+    fprintf(fp, " %s\n", profile->slowest[i].detail);
+  }
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* PERF COUNTERS ***************
+  --perf-counters. One perf_event_open() group for the tracer (this thread) and one for the tracee (its main
+  thread, because inherit doesn't go with a group read), each with the software events task-clock,
+  context-switches, cpu-migrations, page-faults and, where the machine has them, the hardware events cycles and
+  instructions. An event that can't be opened (no PMU, e.g. in many VMs) is left out. If kernel counting
+  isn't allowed (perf_event_paranoid 2 for a non-root user), events are reopened to count user space only, and
+  the table says so. The groups are read with one read() each at every phase change (pgoptionfiles_tracer_phase()),
+  and the difference goes to the phase that's ending. If the kernel multiplexed a group, values are scaled by
+  time_enabled / time_running the way perf stat does. A tracee's counters can still be read after it has ended.
+  With --backend dlmopen the counters are opened before dlmopen(), so the load row is the load and patching,
+  on the first run with a library; later runs reuse the loaded library and their load row is near 0.
+  pgoptionfiles_perf_close() is called on every path that opened them, including failures before the trace.
+*/
+
+static const struct { const char *name; uint32_t type; uint64_t config; } pgoptionfiles_perf_events[PGOPTIONFILES_PERF_EVENTS]=
+{
+  {"task_ms", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+  {"ctx_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+  {"migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+  {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+  {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}
+};
+
+/* Pass: perf, process (PGOPTIONFILES_PERF_TRACER or _TRACEE), pid (0 = this thread). Do: open its group. */
+static void pgoptionfiles_perf_open_process(struct pgoptionfiles_perf *perf, int process, pid_t pid)
+{
+  int is_user_only= 0;
+  for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event)
+  {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size= sizeof(attr);
+    attr.type= pgoptionfiles_perf_events[event].type;
+    attr.config= pgoptionfiles_perf_events[event].config;
+    attr.read_format= PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel= is_user_only;
+    attr.exclude_hv= is_user_only;
+    int fd= syscall(SYS_perf_event_open, &attr, pid, -1, perf->leader_fds[process], PERF_FLAG_FD_CLOEXEC);
+    if ((fd < 0) && ((errno == EACCES) || (errno == EPERM)) && (is_user_only == 0))
+    {
+      /* From now on this process's events are all user-only, the group has to agree */
+      is_user_only= 1;
+      attr.exclude_kernel= 1;
+      attr.exclude_hv= 1;
+      if (perf->leader_fds[process] >= 0) { --event; continue; } /* can't change the leader, keep going user-only */
+      fd= syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    }
+    perf->is_user_only[process][event]= is_user_only;
+    if (fd < 0) continue; /* e.g. ENOENT for no hardware counters */
+    if (perf->leader_fds[process] < 0) perf->leader_fds[process]= fd;
+    else perf->member_fds[process][perf->member_count[process]++]= fd;
+    perf->positions[process][event]= perf->event_count[process]++;
+  }
+}
+
+/* Do: read a group, scaled values go to values[] (events that aren't there stay 0). Return: 0 ok, -1 can't. */
+static int pgoptionfiles_perf_read(const struct pgoptionfiles_perf *perf, int process, unsigned long long *values)
+{
+  uint64_t buffer[3 + PGOPTIONFILES_PERF_EVENTS]; /* nr, time_enabled, time_running, value... */
+  memset(values, 0, sizeof(unsigned long long) * PGOPTIONFILES_PERF_EVENTS);
+  if (perf->leader_fds[process] < 0) return -1;
+  if (read(perf->leader_fds[process], buffer, sizeof(buffer)) < (ssize_t) (3 * sizeof(uint64_t))) return -1;
+  double scale= ((buffer[2] > 0) && (buffer[2] < buffer[1])) ? (double) buffer[1] / buffer[2] : 1.0;
+  for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event)
+    if ((perf->positions[process][event] >= 0) && ((uint64_t) perf->positions[process][event] < buffer[0]))
+      values[event]= (unsigned long long) (buffer[3 + perf->positions[process][event]] * scale);
+  return 0;
+}
+
+/*
+  Pass: state, tracee pid or 0 if there's no tracee process (--backend dlmopen, --replay)
+  Do: if --perf-counters, start counting. The tracee is already running, e.g. in dlopen(), which is the load phase.
+*/
+void pgoptionfiles_perf_open(struct pgoptionfiles_state *state, pid_t tracee_pid)
+{
+  if (state->options->is_perf_counters == 0) return;
+  struct pgoptionfiles_perf *perf= calloc(1, sizeof(*perf));
+  if (perf == NULL) return;
+  for (int process= 0; process < PGOPTIONFILES_PERF_PROCESSES; ++process)
+  {
+    perf->leader_fds[process]= -1;
+    for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event) perf->positions[process][event]= -1;
+  }
+  pgoptionfiles_perf_open_process(perf, PGOPTIONFILES_PERF_TRACER, 0);
+  if (tracee_pid > 0) pgoptionfiles_perf_open_process(perf, PGOPTIONFILES_PERF_TRACEE, tracee_pid);
+  for (int process= 0; process < PGOPTIONFILES_PERF_PROCESSES; ++process)
+    pgoptionfiles_perf_read(perf, process, perf->last[process]);
+  state->perf= perf;
+}
+
+/* Do: at a phase change, before state->phase changes: what's happened since the last read goes to state->phase */
+void pgoptionfiles_perf_phase(struct pgoptionfiles_state *state)
+{
+  struct pgoptionfiles_perf *perf= state->perf;
+  unsigned long long values[PGOPTIONFILES_PERF_EVENTS];
+  for (int process= 0; process < PGOPTIONFILES_PERF_PROCESSES; ++process)
+  {
+    if (pgoptionfiles_perf_read(perf, process, values) != 0) continue;
+    for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event)
+    {
+      if (values[event] >= perf->last[process][event])
+        perf->counts[process][state->phase][event]+= values[event] - perf->last[process][event];
+      perf->last[process][event]= values[event];
+    }
+  }
+}
+
+/* Do: print the table. After the last pgoptionfiles_tracer_phase(). */
+void pgoptionfiles_perf_print(struct pgoptionfiles_state *state, FILE *fp)
+{
+  static const char *process_names[PGOPTIONFILES_PERF_PROCESSES]= {"tracer", "tracee"};
+  struct pgoptionfiles_perf *perf= state->perf;
+  const char *library_name= state->options->library_name;
+  if (library_name == NULL) library_name= (state->options->replay_file_name != NULL) ? state->options->replay_file_name : "";
+  fprintf(fp, "(pgoptionfiles)(perf-counters %s)\n", library_name);
+  fprintf(fp, "%-7s %-8s %10s", "process", "phase", "wall_ms");
+  for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event) fprintf(fp, " %13s", pgoptionfiles_perf_events[event].name);
+  fprintf(fp, "\n");
+  for (int process= 0; process < PGOPTIONFILES_PERF_PROCESSES; ++process)
+  {
+    if (perf->leader_fds[process] < 0) continue;
+    for (int phase= 0; phase < PGOPTIONFILES_PHASE_COUNT; ++phase)
+    {
+      fprintf(fp, "%-7s %-8s %10.3f", process_names[process], pgoptionfiles_phase_names[phase], state->metrics.phase_nanoseconds[phase] / 1e6);
+      for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event)
+      {
+        if (perf->positions[process][event] < 0) fprintf(fp, " %13s", "-");
+        else if (event == 0) /* task-clock is nanoseconds */
+          fprintf(fp, " %13.3f", perf->counts[process][phase][event] / 1e6);
+        else fprintf(fp, " %13llu", perf->counts[process][phase][event]);
+      }
+      fprintf(fp, "\n");
+    }
+    for (int event= 0; event < PGOPTIONFILES_PERF_EVENTS; ++event)
+      if ((perf->positions[process][event] >= 0) && (perf->is_user_only[process][event] == 1))
+      {
+        fprintf(fp, "(%s counters are user space only, perf_event_paranoid doesn't allow kernel counting)\n", process_names[process]);
+        break;
+      }
+  }
+  if (perf->leader_fds[PGOPTIONFILES_PERF_TRACER] < 0) fprintf(fp, "(no counters, is perf_event_open() allowed?)\n");
+}
+
+/* Do: close the counters and free state->perf, if any. At the end, or when giving up before the trace starts. */
+void pgoptionfiles_perf_close(struct pgoptionfiles_state *state)
+{
+  struct pgoptionfiles_perf *perf= state->perf;
+  if (perf == NULL) return;
+  for (int process= 0; process < PGOPTIONFILES_PERF_PROCESSES; ++process)
+  {
+    for (int i= 0; i < perf->member_count[process]; ++i) close(perf->member_fds[process][i]);
+    if (perf->leader_fds[process] >= 0) close(perf->leader_fds[process]);
+  }
+  free(perf);
+  state->perf= NULL;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* PLACEMENT ***************
+  --placement, --sched, --compare-placement. Every syscall stop is two wakeups: the tracee stops and the tracer
+  returns from waitpid(), then the tracer does PTRACE_SYSCALL and the tracee runs. How long a wakeup takes depends
+  on where the two processes are and how the scheduler treats them, so that's what these options choose.
+    same      one CPU for both. A wakeup is a context switch on that CPU, no inter-processor interrupt, and the
+              caches are warm, but the tracer and tracee never run at the same time.
+    siblings  the tracee is on another hardware thread of the tracer's core (SMT) if there is one, else on another
+              core of the same package, so wakeups cross CPUs but the caches are shared.
+    spread    the tracee is on another core, in another package if there is one. It's here for comparison.
+  The tracer's CPU is ,CPU if given, else the CPU that it's on now. Topology is from
+  /sys/devices/system/cpu/cpuN/topology, and only CPUs that this process may use are chosen.
+  pgoptionfiles_placement_start() pins the tracer and sets its policy before the tracee exists, so the tracee
+  inherits both, then pgoptionfiles_placement_tracee() moves the tracee for siblings or spread.
+  pgoptionfiles_placement_end() puts the tracer's affinity and policy back, so a program that calls
+  pgoptionfiles_run() is left as it was. With --pid or --backend dlmopen there's no tracee of ours to move.
+  The choice is in a static, as with the dlmopen backend there's one pgoptionfiles_run() at a time in a process.
+*/
+
+static struct pgoptionfiles_placement pgoptionfiles_placement_now= {-1, -1, 0, {{0}}, 0, 0, {0}};
+
+/* Do: read a sysfs CPU list such as "0-3,8\n" into cpus. Return: 0 ok, -1 if there's no such file. */
+static int pgoptionfiles_placement_read_cpus(int cpu, const char *topology_name, cpu_set_t *cpus)
+{
+  char path[128];
+  char text[1024];
+  CPU_ZERO(cpus);
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, topology_name);
+  int fd= open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  ssize_t length= read(fd, text, sizeof(text) - 1);
+  close(fd);
+  if (length <= 0) return -1;
+  text[length]= '\0';
+  for (char *p= text; (*p != '\0') && (*p != '\n'); )
+  {
+    char *end;
+    long first= strtol(p, &end, 10);
+    if (end == p) break;
+    long last= first;
+    if (*end == '-') last= strtol(end + 1, &end, 10);
+    for (long i= first; (i <= last) && (i < CPU_SETSIZE); ++i) CPU_SET(i, cpus);
+    p= (*end == ',') ? end + 1 : end;
+  }
+  return 0;
+}
+
+/*
+  Pass: "siblings" or "spread", the tracer's CPU, the CPUs this process may use
+  Return: the tracee's CPU, or -1 if there's none that fits
+  Candidates are ranked: same core, same package, other package. siblings wants the lowest rank but not other
+  package, spread wants the highest rank but not same core.
+*/
+static int pgoptionfiles_placement_partner(const char *name, int cpu, const cpu_set_t *allowed)
+{
+  cpu_set_t threads, package;
+  if (pgoptionfiles_placement_read_cpus(cpu, "thread_siblings_list", &threads) != 0) CPU_SET(cpu, &threads);
+  if (pgoptionfiles_placement_read_cpus(cpu, "core_siblings_list", &package) != 0) package= *allowed; /* as if one package */
+  int is_spread= (strcmp(name, "spread") == 0);
+  int best_cpu= -1, best_rank= 2;
+  for (int candidate= 0; candidate < CPU_SETSIZE; ++candidate)
+  {
+    if ((candidate == cpu) || !CPU_ISSET(candidate, allowed)) continue;
+    int rank= CPU_ISSET(candidate, &threads) ? 0 : (CPU_ISSET(candidate, &package) ? 1 : 2);
+    if (is_spread) rank= 2 - rank;
+    if (rank < best_rank) { best_cpu= candidate; best_rank= rank; }
+  }
+  return best_cpu;
+}
+
+/*
+  Pass: options, error_list
+  Do: if --placement, pin this process (the tracer) to its CPU. If --sched, change its scheduling policy.
+      fifo and rr get the lowest real-time priority, which is enough to go ahead of every other, normal, process.
+  Return: 0 ok, -1 error (with "Error: ..." appended to error_list, and nothing changed)
+*/
+int pgoptionfiles_placement_start(const struct pgoptionfiles_options *options, char *error_list)
+{
+  struct pgoptionfiles_placement *now= &pgoptionfiles_placement_now;
+  now->tracer_cpu= now->tracee_cpu= -1;
+  now->is_affinity_saved= now->is_policy_saved= 0;
+  if ((options->placement != NULL) && (strncmp(options->placement, "none", 4) != 0))
+  {
+    char name[16];
+    snprintf(name, sizeof(name), "%.*s", (int) strcspn(options->placement, ","), options->placement);
+    const char *comma= strchr(options->placement, ',');
+    if (sched_getaffinity(0, sizeof(now->saved_cpus), &now->saved_cpus) != 0)
+    {
+      strcat(error_list, "Error: sched_getaffinity() failed.");
+      return -1;
+    }
+    int cpu= (comma != NULL) ? atoi(comma + 1) : sched_getcpu();
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE) || !CPU_ISSET(cpu, &now->saved_cpus))
+    {
+      sprintf(error_list + strlen(error_list), "Error: --placement CPU %d isn't one that this process may use.", cpu);
+      return -1;
+    }
+    int partner_cpu= cpu;
+    if (strcmp(name, "same") != 0) partner_cpu= pgoptionfiles_placement_partner(name, cpu, &now->saved_cpus);
+    if (partner_cpu < 0)
+    {
+      sprintf(error_list + strlen(error_list), "Error: --placement %s needs a CPU %s CPU %d, and there isn't one that this process may use.",
+              name, (strcmp(name, "siblings") == 0) ? "in the same core or package as" : "in another core than", cpu);
+      return -1;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+    {
+      strcat(error_list, "Error: sched_setaffinity() failed.");
+      return -1;
+    }
+    now->tracer_cpu= cpu;
+    now->tracee_cpu= partner_cpu;
+    now->is_affinity_saved= 1;
+  }
+  if (options->sched != NULL)
+  {
+    int policy= SCHED_OTHER;
+    if (strcmp(options->sched, "batch") == 0) policy= SCHED_BATCH;
+    else if (strcmp(options->sched, "idle") == 0) policy= SCHED_IDLE;
+    else if (strcmp(options->sched, "fifo") == 0) policy= SCHED_FIFO;
+    else if (strcmp(options->sched, "rr") == 0) policy= SCHED_RR;
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if ((policy == SCHED_FIFO) || (policy == SCHED_RR)) param.sched_priority= sched_get_priority_min(policy);
+    now->saved_policy= sched_getscheduler(0);
+    if ((now->saved_policy < 0) || (sched_getparam(0, &now->saved_param) != 0) || (sched_setscheduler(0, policy, &param) != 0))
+    {
+      int saved_errno= errno;
+      pgoptionfiles_placement_end();
+      if ((saved_errno == EPERM) && ((policy == SCHED_FIFO) || (policy == SCHED_RR)))
+        sprintf(error_list + strlen(error_list), "Error: --sched %s needs CAP_SYS_NICE or an RLIMIT_RTPRIO limit (ulimit -r) of at least %d.",
+                options->sched, param.sched_priority);
+      else sprintf(error_list + strlen(error_list), "Error: sched_setscheduler() failed: %s.", strerror(saved_errno));
+      return -1;
+    }
+    now->is_policy_saved= 1;
+  }
+  return 0;
+}
+
+/* Pass: the tracee, which has the tracer's CPU and policy. Do: move it to its own CPU if that's different. */
+void pgoptionfiles_placement_tracee(pid_t tracee_pid)
+{
+  struct pgoptionfiles_placement *now= &pgoptionfiles_placement_now;
+  if ((now->tracee_cpu < 0) || (now->tracee_cpu == now->tracer_cpu)) return;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(now->tracee_cpu, &cpus);
+  sched_setaffinity(tracee_pid, sizeof(cpus), &cpus); /* if it fails the tracee is on the tracer's CPU, i.e. same */
+}
+
+/* Do: put back what pgoptionfiles_placement_start() changed. tracer_cpu and tracee_cpu stay, for reports. */
+void pgoptionfiles_placement_end(void)
+{
+  struct pgoptionfiles_placement *now= &pgoptionfiles_placement_now;
+  if (now->is_policy_saved == 1) sched_setscheduler(0, now->saved_policy, &now->saved_param);
+  if (now->is_affinity_saved == 1) sched_setaffinity(0, sizeof(now->saved_cpus), &now->saved_cpus);
+  now->is_policy_saved= now->is_affinity_saved= 0;
+}
+
+static int pgoptionfiles_compare_int64(const void *a, const void *b)
+{
+  int64_t x= *(const int64_t *) a, y= *(const int64_t *) b;
+  return (x > y) - (x < y);
+}
+
+/*
+  Pass: options with is_compare_placement == 1
+  Do: for each of --placement none, same, siblings, spread: one untimed run (so the page cache and the branch
+      predictors are the same for every placement), then PGOPTIONFILES_COMPARE_RUNS timed runs. Print e.g.
+        (pgoptionfiles)(compare-placement library-name)(runs 20)(sched other)
+        placement tracer_cpu tracee_cpu  stops  median_stop_ns  min_stop_ns  median_waitpid_ns  median_trace_ms
+        none               -          -    412           10408         9655              8012            4.611
+        same               0          0    412            7734         7503              5310            3.392
+        siblings           0          4    412            8291         8004              5899            3.571
+        spread             0          1    412           11020        10711              8630            4.843
+        (best same)
+      stop_ns is the time of the traced phases (not load, which is untraced) / syscall stops, i.e. the whole cost
+      of a stop, tracer and tracee and two wakeups. waitpid_ns is the part of it that the tracer was waiting,
+      also without the load phase.
+      A placement that can't be done, e.g. siblings on a machine with one CPU, has its error instead of numbers.
+      --sched and --query and --read etc. apply to every run. Output goes nowhere, only the times matter.
+  Return: 0, or if even the unplaced runs fail, their result code
+*/
+int pgoptionfiles_compare_placement(const struct pgoptionfiles_options *options)
+{
+  static const char *placements[]= {"none", "same", "siblings", "spread"};
+  struct pgoptionfiles_options run_options= *options;
+  struct pgoptionfiles_metrics metrics;
+  run_options.is_compare_placement= 0;
+  run_options.metrics_result= &metrics;
+  int64_t stop_nanoseconds[PGOPTIONFILES_COMPARE_RUNS];
+  int64_t waitpid_nanoseconds[PGOPTIONFILES_COMPARE_RUNS];
+  int64_t trace_nanoseconds[PGOPTIONFILES_COMPARE_RUNS];
+  int result= 0;
+  const char *best_placement= NULL;
+  int64_t best_median= 0;
+  printf("(pgoptionfiles)(compare-placement %s)(runs %d)(sched %s)\n", options->library_name, PGOPTIONFILES_COMPARE_RUNS,
+         (options->sched == NULL) ? "unchanged" : options->sched);
+  printf("%-9s %10s %10s %6s %15s %12s %18s %16s\n", "placement", "tracer_cpu", "tracee_cpu", "stops",
+         "median_stop_ns", "min_stop_ns", "median_waitpid_ns", "median_trace_ms");
+  fflush(stdout);
+  for (unsigned int p= 0; p < sizeof(placements) / sizeof(placements[0]); ++p)
+  {
+    run_options.placement= placements[p];
+    char error_list[4096]= "";
+    unsigned long long stops= 0;
+    int result_code= 0;
+    for (int run= -1; run < PGOPTIONFILES_COMPARE_RUNS; ++run)
+    {
+      struct pgoptionfiles_list file_names_list;
+      pgoptionfiles_list_init(&file_names_list);
+      memset(&metrics, 0, sizeof(metrics));
+      error_list[0]= '\0';
+      result_code= pgoptionfiles_run(&file_names_list, error_list, &run_options);
+      pgoptionfiles_list_free(&file_names_list);
+      if ((result_code != 0) || (strstr(error_list, "Error: ") != NULL)) break;
+      if (run < 0) continue;
+      int64_t traced_nanoseconds= metrics.trace_nanoseconds - metrics.phase_nanoseconds[PGOPTIONFILES_PHASE_LOAD];
+      unsigned long long run_stops= (metrics.syscall_stops == 0) ? 1 : metrics.syscall_stops;
+      stop_nanoseconds[run]= traced_nanoseconds / (int64_t) run_stops;
+      waitpid_nanoseconds[run]= (metrics.waitpid_nanoseconds - metrics.load_waitpid_nanoseconds) / (int64_t) run_stops;
+      trace_nanoseconds[run]= metrics.trace_nanoseconds;
+      stops= metrics.syscall_stops;
+    }
+    const char *error= strstr(error_list, "Error: ");
+    if ((result_code != 0) || (error != NULL))
+    {
+      printf("%-9s (%s)\n", placements[p], (error == NULL) ? "Error: trace failed." : error);
+      if ((p == 0) && (result == 0)) result= (result_code != 0) ? result_code : -1;
+      continue;
+    }
+    const struct pgoptionfiles_placement *placed= &pgoptionfiles_placement_now;
+    char tracer_cpu[16]= "-", tracee_cpu[16]= "-";
+    if (placed->tracer_cpu >= 0) sprintf(tracer_cpu, "%d", placed->tracer_cpu);
+    if (placed->tracee_cpu >= 0) sprintf(tracee_cpu, "%d", placed->tracee_cpu);
+    qsort(stop_nanoseconds, PGOPTIONFILES_COMPARE_RUNS, sizeof(int64_t), pgoptionfiles_compare_int64);
+    qsort(waitpid_nanoseconds, PGOPTIONFILES_COMPARE_RUNS, sizeof(int64_t), pgoptionfiles_compare_int64);
+    qsort(trace_nanoseconds, PGOPTIONFILES_COMPARE_RUNS, sizeof(int64_t), pgoptionfiles_compare_int64);
+    int64_t median= stop_nanoseconds[PGOPTIONFILES_COMPARE_RUNS / 2];
+    printf("%-9s %10s %10s %6llu %15lld %12lld %18lld %16.3f\n", placements[p], tracer_cpu, tracee_cpu, stops,
+           (long long) median, (long long) stop_nanoseconds[0], (long long) waitpid_nanoseconds[PGOPTIONFILES_COMPARE_RUNS / 2],
+           trace_nanoseconds[PGOPTIONFILES_COMPARE_RUNS / 2] / 1e6);
+    fflush(stdout);
+    if ((best_placement == NULL) || (median < best_median)) { best_placement= placements[p]; best_median= median; }
+  }
+  if (best_placement != NULL) printf("(best %s)\n", best_placement);
+  return result;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) && (PGOPTIONFILES_PREFETCH == 1)
+/*
+  ******************* PREFETCH ***************
+  Find the dependency closure of the library the way ld.so would (DT_RPATH if no DT_RUNPATH, LD_LIBRARY_PATH,
+  DT_RUNPATH, /etc/ld.so.cache, default directories, $ORIGIN substitution), breadth first.
+  posix_fadvise(WILLNEED) happens right after open() and before the ELF headers are read, so every file
+  found so far is being read while we parse, and the parse waits only for pages it needs anyway.
+  Reads are with pread() of only the headers, dynamic section, and string table; no mmap() of the whole file.
+  pgoptionfiles_run() does it in a thread, see pgoptionfiles_prefetch_start(), so nothing waits for it
+  except the end of the job.
+  Not handled: $LIB and $PLATFORM, hwcaps subdirectories, DT_NEEDED of libraries that ld.so already has
+  loaded -- those are in the page cache already, that's what matters.
+*/
+
+/* Return: 1 if file exists and was added to the queue, 0 if not */
+static int pgoptionfiles_prefetch_add(char **queue, int *queue_count, const char *file_name)
+{
+  if (*queue_count >= PGOPTIONFILES_PREFETCH_MAX_FILES) return 0;
+  if (access(file_name, F_OK) != 0) return 0;
+  for (int i= 0; i < *queue_count; ++i) if (strcmp(queue[i], file_name) == 0) return 1;
+  char *copy= strdup(file_name);
+  if (copy == NULL) return 0;
+  queue[(*queue_count)++]= copy;
+  return 1;
+}
+
+/*
+  Pass: colon-separated directories e.g. DT_RUNPATH or LD_LIBRARY_PATH, directory of the referencing file for $ORIGIN
+  Return: 1 if found and added, else 0
+*/
+static int pgoptionfiles_prefetch_search(char **queue, int *queue_count, const char *needed, const char *path_list, const char *origin)
+{
+  if (path_list == NULL) return 0;
+  const char *p= path_list;
+  while (*p != '\0')
+  {
+    size_t length= strcspn(p, ":");
+    char file_name[PATH_MAX];
+    size_t file_name_length= 0;
+    const char *directory= p;
+    size_t directory_length= length;
+    if ((strncmp(directory, "$ORIGIN", 7) == 0) && ((directory_length == 7) || (directory[7] == '/')))
+    {
+      file_name_length= snprintf(file_name, sizeof(file_name), "%s", origin);
+      directory+= 7;
+      directory_length-= 7;
+    }
+    else if ((strncmp(directory, "${ORIGIN}", 9) == 0) && ((directory_length == 9) || (directory[9] == '/')))
+    {
+      file_name_length= snprintf(file_name, sizeof(file_name), "%s", origin);
+      directory+= 9;
+      directory_length-= 9;
+    }
+    if (file_name_length + directory_length + strlen(needed) + 2 < sizeof(file_name))
+    {
+      memcpy(file_name + file_name_length, directory, directory_length);
+      file_name_length+= directory_length;
+      if (file_name_length == 0) file_name[file_name_length++]= '.'; /* empty entry means current directory */
+      file_name[file_name_length++]= '/';
+      strcpy(file_name + file_name_length, needed);
+      if (pgoptionfiles_prefetch_add(queue, queue_count, file_name) == 1) return 1;
+    }
+    p+= length;
+    if (*p == ':') ++p;
+  }
+  return 0;
+}
+
+/* Return: 1 if needed is in /etc/ld.so.cache (new format, possibly after the old format) for this word size, else 0 */
+static int pgoptionfiles_prefetch_search_cache(char **queue, int *queue_count, const char *needed, const char *cache, size_t cache_size)
+{
+  const char *cache_new= cache;
+  if ((cache_size >= 16) && (memcmp(cache, "ld.so-1.7.0", 11) == 0))
+  {
+    uint32_t old_count;
+    memcpy(&old_count, cache + 12, 4);
+    size_t offset= 16 + (size_t) old_count * 12;
+    offset= (offset + 7) & ~(size_t) 7;
+    if (offset >= cache_size) return 0;
+    cache_new= cache + offset;
+  }
+  size_t new_size= cache_size - (cache_new - cache);
+  if ((new_size < 48) || (memcmp(cache_new, "glibc-ld.so.cache1.1", 20) != 0)) return 0;
+  uint32_t count;
+  memcpy(&count, cache_new + 20, 4);
+  if (48 + (size_t) count * 24 > new_size) return 0;
+  for (uint32_t i= 0; i < count; ++i)
+  {
+    const char *entry= cache_new + 48 + (size_t) i * 24;
+    int32_t flags;
+    uint32_t key, value;
+    memcpy(&flags, entry, 4);
+    memcpy(&key, entry + 4, 4);
+    memcpy(&value, entry + 8, 4);
+    if ((key >= new_size) || (value >= new_size)) continue;
+    if ((flags & 0xff) != 3) continue; /* FLAG_ELF_LIBC6 */
+#if (__SIZEOF_POINTER__ == 8)
+    if (((flags & 0xff00) == 0) || ((flags & 0xff00) == 0x0800)) continue; /* 32-bit i386 or x32 */
+#else
+    if ((flags & 0xff00) != 0) continue;
+#endif
+    if (strnlen(cache_new + key, new_size - key) == new_size - key) continue;
+    if (strcmp(cache_new + key, needed) != 0) continue;
+    if (strnlen(cache_new + value, new_size - value) == new_size - value) continue;
+    if (pgoptionfiles_prefetch_add(queue, queue_count, cache_new + value) == 1) return 1;
+  }
+  return 0;
+}
+
+/*
+  Pass: library name as passed to dlopen()
+  Do: posix_fadvise(WILLNEED) for it and everything it needs, see above
+  Return: number of files, which is only interesting for debugging
+*/
+int pgoptionfiles_prefetch(const char *library_name)
+{
+  char *queue[PGOPTIONFILES_PREFETCH_MAX_FILES];
+  int queue_count= 0;
+  if (strchr(library_name, '/') == NULL) return 0; /* dlopen() would search, we're not going to guess the same way */
+  if (pgoptionfiles_prefetch_add(queue, &queue_count, library_name) == 0) return 0;
+  const char *cache= MAP_FAILED;
+  size_t cache_size= 0;
+  int cache_fd= open("/etc/ld.so.cache", O_RDONLY | O_CLOEXEC);
+  if (cache_fd >= 0)
+  {
+    struct stat cache_stat;
+    if ((fstat(cache_fd, &cache_stat) == 0) && (cache_stat.st_size > 0))
+    {
+      cache_size= cache_stat.st_size;
+      cache= mmap(NULL, cache_size, PROT_READ, MAP_PRIVATE, cache_fd, 0);
+    }
+    close(cache_fd);
+  }
+  const char *ld_library_path= getenv("LD_LIBRARY_PATH");
+  static const char *default_path= "/lib64:/usr/lib64:/lib:/usr/lib";
+  for (int queue_number= 0; queue_number < queue_count; ++queue_number)
+  {
+    int fd= open(queue[queue_number], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) continue;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ElfW(Ehdr) ehdr;
+    ElfW(Phdr) phdrs[64];
+    char *dynamic= NULL;
+    char *strtab= NULL;
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) != (ssize_t) sizeof(ehdr)) goto next;
+    if ((memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0) || (ehdr.e_ident[EI_CLASS] != ((__SIZEOF_POINTER__ == 8) ? ELFCLASS64 : ELFCLASS32))) goto next;
+    if ((ehdr.e_phentsize != sizeof(ElfW(Phdr))) || (ehdr.e_phnum == 0) || (ehdr.e_phnum > 64)) goto next;
+    if (pread(fd, phdrs, ehdr.e_phnum * sizeof(ElfW(Phdr)), ehdr.e_phoff) != (ssize_t) (ehdr.e_phnum * sizeof(ElfW(Phdr)))) goto next;
+    {
+      const ElfW(Phdr) *dynamic_phdr= NULL;
+      for (int i= 0; i < ehdr.e_phnum; ++i) if (phdrs[i].p_type == PT_DYNAMIC) dynamic_phdr= &phdrs[i];
+      if ((dynamic_phdr == NULL) || (dynamic_phdr->p_filesz == 0) || (dynamic_phdr->p_filesz > 65536)) goto next;
+      dynamic= malloc(dynamic_phdr->p_filesz);
+      if (dynamic == NULL) goto next;
+      if (pread(fd, dynamic, dynamic_phdr->p_filesz, dynamic_phdr->p_offset) != (ssize_t) dynamic_phdr->p_filesz) goto next;
+      size_t dyn_count= dynamic_phdr->p_filesz / sizeof(ElfW(Dyn));
+      const ElfW(Dyn) *dyn= (const ElfW(Dyn) *) dynamic;
+      ElfW(Addr) strtab_address= 0;
+      size_t strtab_size= 0;
+      for (size_t i= 0; (i < dyn_count) && (dyn[i].d_tag != DT_NULL); ++i)
+      {
+        if (dyn[i].d_tag == DT_STRTAB) strtab_address= dyn[i].d_un.d_ptr;
+        else if (dyn[i].d_tag == DT_STRSZ) strtab_size= dyn[i].d_un.d_val;
+      }
+      if ((strtab_address == 0) || (strtab_size == 0) || (strtab_size > 1048576)) goto next;
+      /* DT_STRTAB is an address, find the PT_LOAD that contains it to get the file offset */
+      off_t strtab_offset= -1;
+      for (int i= 0; i < ehdr.e_phnum; ++i)
+        if ((phdrs[i].p_type == PT_LOAD) && (strtab_address >= phdrs[i].p_vaddr) && (strtab_address + strtab_size <= phdrs[i].p_vaddr + phdrs[i].p_filesz))
+          strtab_offset= strtab_address - phdrs[i].p_vaddr + phdrs[i].p_offset;
+      if (strtab_offset < 0) goto next;
+      strtab= malloc(strtab_size + 1);
+      if (strtab == NULL) goto next;
+      if (pread(fd, strtab, strtab_size, strtab_offset) != (ssize_t) strtab_size) goto next;
+      strtab[strtab_size]= '\0';
+      const char *rpath= NULL, *runpath= NULL;
+      for (size_t i= 0; (i < dyn_count) && (dyn[i].d_tag != DT_NULL); ++i)
+      {
+        if ((dyn[i].d_tag == DT_RPATH) && (dyn[i].d_un.d_val < strtab_size)) rpath= strtab + dyn[i].d_un.d_val;
+        else if ((dyn[i].d_tag == DT_RUNPATH) && (dyn[i].d_un.d_val < strtab_size)) runpath= strtab + dyn[i].d_un.d_val;
+      }
+      if (runpath != NULL) rpath= NULL;
+      char origin[PATH_MAX];
+      snprintf(origin, sizeof(origin), "%s", queue[queue_number]);
+      char *slash= strrchr(origin, '/');
+      if (slash == origin) slash[1]= '\0';
+      else if (slash != NULL) *slash= '\0';
+      for (size_t i= 0; (i < dyn_count) && (dyn[i].d_tag != DT_NULL); ++i)
+      {
+        if ((dyn[i].d_tag != DT_NEEDED) || (dyn[i].d_un.d_val >= strtab_size)) continue;
+        const char *needed= strtab + dyn[i].d_un.d_val;
+        if (strchr(needed, '/') != NULL) { pgoptionfiles_prefetch_add(queue, &queue_count, needed); continue; }
+        if (pgoptionfiles_prefetch_search(queue, &queue_count, needed, rpath, origin) == 1) continue;
+        if (pgoptionfiles_prefetch_search(queue, &queue_count, needed, ld_library_path, origin) == 1) continue;
+        if (pgoptionfiles_prefetch_search(queue, &queue_count, needed, runpath, origin) == 1) continue;
+        if ((cache != MAP_FAILED) && (pgoptionfiles_prefetch_search_cache(queue, &queue_count, needed, cache, cache_size) == 1)) continue;
+        pgoptionfiles_prefetch_search(queue, &queue_count, needed, default_path, origin);
+      }
+    }
+next:
+    free(strtab);
+    free(dynamic);
+    close(fd);
+  }
+  if (cache != MAP_FAILED) munmap((void *) cache, cache_size);
+  for (int i= 0; i < queue_count; ++i) free(queue[i]);
+  return queue_count;
+}
+
+/* pthread_create() start routine, see pgoptionfiles_prefetch_start() */
+static void *pgoptionfiles_prefetch_thread(void *library_name)
+{
+  pgoptionfiles_prefetch((const char *) library_name);
+  return NULL;
+}
+
+/*
+  Pass: library name as passed to dlopen(), which must last till the join, address of thread id
+  Do: pgoptionfiles_prefetch() in a thread, so the caller can go on to start and seize the tracee at once.
+      A thread and not a fork() child because with PGOPTIONFILES_LIBRARY the caller can be multithreaded, see ASYNC.
+  Return: 0 and the caller must pthread_join(), or -1 if pthread_create() failed (then there's no prefetch)
+*/
+int pgoptionfiles_prefetch_start(const char *library_name, pthread_t *thread)
+{
+  if (pthread_create(thread, NULL, pgoptionfiles_prefetch_thread, (void *) library_name) != 0) return -1;
+  return 0;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* SECCOMP BACKEND ***************
+  --backend seccomp: instead of ptrace(), the tracee installs a seccomp filter that returns SECCOMP_RET_USER_NOTIF
+  for the syscalls that pgoptionfiles_tracer_arg_number() accepts, and everything else is allowed without any stop.
+  The tracee sends the listener fd to the supervisor (this process) with SCM_RIGHTS.
+  The supervisor gets a notification for each relevant syscall, reads the file name from /proc/pid/mem,
+  does the same pgoptionfiles_tracer_file_name() as the tracer, then answers either "fail with ENOENT"
+  (what the tracer does without --read by changing a register) or "continue" (SECCOMP_USER_NOTIF_FLAG_CONTINUE).
+  Needs Linux 5.5. There are no metrics for stops or PTRACE_PEEKDATA because there aren't any.
+  An entry's status is denied or unknown, because the supervisor doesn't see the syscall's end.
+  The supervisor ends when the tracee does. The listener only reports POLLHUP for that from Linux 5.8, so the
+  tracee's pidfd (pidfd_open(), 5.3) is polled as well, or if there's no pidfd, waitpid(WNOHANG) every
+  PGOPTIONFILES_SECCOMP_CHECK_MS.
+*/
+
+#ifndef PGOPTIONFILES_SECCOMP_CHECK_MS
+#define PGOPTIONFILES_SECCOMP_CHECK_MS 100
+#endif
+
+/*
+  In the tracee (child), before pgoptionfiles_tracee().
+  Pass: socket for sending the listener fd
+  Return: 0 ok, -1 error, in which case nothing was sent so the supervisor will see end-of-file
+*/
+int pgoptionfiles_seccomp_tracee_start(int socket_fd)
+{
+  unsigned int syscall_numbers[16];
+  unsigned int syscall_count= 0;
+  /* Every syscall number < 1024 that pgoptionfiles_tracer_arg_number() accepts, so the two backends can't disagree */
+  for (unsigned int nr= 0; (nr < 1024) && (syscall_count < 16); ++nr)
+    if (pgoptionfiles_tracer_arg_number(nr) >= 0) syscall_numbers[syscall_count++]= nr;
+  struct sock_filter filter[4 + 16 + 2];
+  unsigned int n= 0;
+  filter[n++]= (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+#ifdef __x86_64__
+  filter[n++]= (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0);
+#else
+  filter[n++]= (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_I386, 1, 0);
+#endif
+  filter[n++]= (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+  filter[n++]= (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+  for (unsigned int i= 0; i < syscall_count; ++i) /* if equal, jump to the USER_NOTIF return which is after the rest */
+    filter[n++]= (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, syscall_numbers[i], syscall_count - i, 0);
+  filter[n++]= (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+  filter[n++]= (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_USER_NOTIF);
+  struct sock_fprog program= {(unsigned short) n, filter};
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0) return -1;
+  int listener_fd= syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_NEW_LISTENER, &program);
+  if (listener_fd < 0) return -1;
+  /* From here on, a relevant syscall would wait for the supervisor, so send before doing anything else */
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+  char dummy= 0;
+  struct iovec iov= {&dummy, 1};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov= &iov;
+  msg.msg_iovlen= 1;
+  msg.msg_control= control;
+  msg.msg_controllen= sizeof(control);
+  struct cmsghdr *cmsg= CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level= SOL_SOCKET;
+  cmsg->cmsg_type= SCM_RIGHTS;
+  cmsg->cmsg_len= CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &listener_fd, sizeof(int));
+  if (sendmsg(socket_fd, &msg, 0) != 1) return -1;
+  close(listener_fd);
+  close(socket_fd);
+  return 0;
+}
+
+/*
+  Pass: pid of any tracee thread, fd of its /proc/pid/mem if known or -1, tracee address, destination
+  Do: like pgoptionfiles_copy_from_tracee() but with pread(), a page at a time so an unmapped next page doesn't matter
+  Return: -1 if error, or # of bytes
+*/
+static int pgoptionfiles_seccomp_copy_from_tracee(pid_t pid, int mem_fd, char *dest, uint64_t src)
+{
+  int is_mem_fd_mine= 0;
+  if (mem_fd < 0)
+  {
+    char mem_file_name[64];
+    sprintf(mem_file_name, "/proc/%d/mem", (int) pid);
+    mem_fd= open(mem_file_name, O_RDONLY | O_CLOEXEC);
+    if (mem_fd < 0) return -1;
+    is_mem_fd_mine= 1;
+  }
+  int dest_offset= 0;
+  int result= -1;
+  while (dest_offset < PATH_MAX - 1)
+  {
+    uint64_t address= src + dest_offset;
+    size_t length= 4096 - (address % 4096);
+    if (length > (size_t) (PATH_MAX - 1 - dest_offset)) length= PATH_MAX - 1 - dest_offset;
+    ssize_t pread_result= pread(mem_fd, dest + dest_offset, length, (off_t) address);
+    if (pread_result <= 0) break;
+    char *nul= memchr(dest + dest_offset, '\0', pread_result);
+    if (nul != NULL) { dest_offset= nul - dest; result= dest_offset; break; }
+    dest_offset+= pread_result;
+  }
+  if (result < 0 && dest_offset == PATH_MAX - 1) result= dest_offset; /* overflow, such path name invalid anyway */
+  if (result >= 0) dest[result]= '\0';
+  if (is_mem_fd_mine) close(mem_fd);
+  return result;
+}
+
+/*
+  Pass: same as pgoptionfiles_run()
+  Do: fork a tracee that will install the filter, then supervise it till it ends
+  Return: same as pgoptionfiles_tracer()
+*/
+int pgoptionfiles_seccomp_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_state state;
+  memset(&state, 0, sizeof(state));
+  state.options= options;
+  state.file_names_list= file_names_list;
+  state.last_entry_number= -1;
+  state.error_list= error_list;
+  clock_gettime(CLOCK_MONOTONIC, &state.start_time);
+  int is_metrics= (options->metrics_format != NULL) || (options->is_perf_counters == 1) /* perf-counters needs phase times */
+                || (options->metrics_result != NULL);
+  int socket_fds[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, socket_fds) != 0) { strcat(error_list, "Error: socketpair() failed"); return -1; }
+  pid_t pid= fork();
+  if (pid < 0) { close(socket_fds[0]); close(socket_fds[1]); strcat(error_list, "Error: fork() failed"); return -1; }
+  if (pid == 0)
+  {
+    close(socket_fds[0]);
+    if (pgoptionfiles_seccomp_tracee_start(socket_fds[1]) != 0) _exit(EXIT_FAILURE);
+    pgoptionfiles_tracee(options, -1);
+  }
+  close(socket_fds[1]);
+  pgoptionfiles_placement_tracee(pid);
+  /* Receive the listener fd */
+  int listener_fd= -1;
+  {
+    char control[CMSG_SPACE(sizeof(int))];
+    char dummy;
+    struct iovec iov= {&dummy, 1};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov= &iov;
+    msg.msg_iovlen= 1;
+    msg.msg_control= control;
+    msg.msg_controllen= sizeof(control);
+    ssize_t recvmsg_result;
+    do recvmsg_result= recvmsg(socket_fds[0], &msg, MSG_CMSG_CLOEXEC); while ((recvmsg_result < 0) && (errno == EINTR));
+    struct cmsghdr *cmsg= CMSG_FIRSTHDR(&msg);
+    if ((recvmsg_result == 1) && (cmsg != NULL) && (cmsg->cmsg_type == SCM_RIGHTS))
+      memcpy(&listener_fd, CMSG_DATA(cmsg), sizeof(int));
+    close(socket_fds[0]);
+  }
+  int status= 0;
+  if (listener_fd < 0)
+  {
+    waitpid(pid, &status, 0);
+    strcat(error_list, "Error: seccomp() failed -- is the kernel older than 5.5?");
+    return -3;
+  }
+  pgoptionfiles_perf_open(&state, pid);
+  char mem_file_name[64];
+  sprintf(mem_file_name, "/proc/%d/mem", (int) pid);
+  int mem_fd= open(mem_file_name, O_RDONLY | O_CLOEXEC);
+  if (pgoptionfiles_record_open(&state) != 0) kill(pid, SIGKILL); /* then the loop ends when the filter goes away */
+  struct seccomp_notif_sizes sizes;
+  if (syscall(SYS_seccomp, SECCOMP_GET_NOTIF_SIZES, 0, &sizes) != 0) { sizes.seccomp_notif= sizeof(struct seccomp_notif); sizes.seccomp_notif_resp= sizeof(struct seccomp_notif_resp); }
+  struct seccomp_notif *request= calloc(1, (sizes.seccomp_notif > sizeof(struct seccomp_notif)) ? sizes.seccomp_notif : sizeof(struct seccomp_notif));
+  struct seccomp_notif_resp *response= calloc(1, (sizes.seccomp_notif_resp > sizeof(struct seccomp_notif_resp)) ? sizes.seccomp_notif_resp : sizeof(struct seccomp_notif_resp));
+  int is_stopped= 0; /* after PGOPTIONFILES_FILE_NAME_STOP, keep answering "continue" till the tracee is gone */
+  int pid_fd= syscall(SYS_pidfd_open, pid, 0);
+  int is_reaped= 0;
+  for (;;)
+  {
+    struct pollfd pfd[2]= {{listener_fd, POLLIN, 0}, {pid_fd, POLLIN, 0}};
+    int64_t wait_start= 0;
+    if (is_metrics) wait_start= pgoptionfiles_nanoseconds_since(&state.start_time);
+    int poll_result= poll(pfd, (pid_fd >= 0) ? 2 : 1, (pid_fd >= 0) ? -1 : PGOPTIONFILES_SECCOMP_CHECK_MS);
+    if (is_metrics)
+    {
+      int64_t waited= pgoptionfiles_nanoseconds_since(&state.start_time) - wait_start;
+      state.metrics.waitpid_nanoseconds+= waited;
+      if (state.phase == PGOPTIONFILES_PHASE_LOAD) state.metrics.load_waitpid_nanoseconds+= waited;
+    }
+    if (poll_result < 0) { if (errno == EINTR) continue; break; }
+    if (pfd[0].revents & (POLLHUP | POLLERR | POLLNVAL)) break; /* no more tracee threads with the filter */
+    if ((poll_result == 0) || (pfd[1].revents & POLLIN))
+    {
+      /* before 5.8 there's no POLLHUP, this is how the end is seen */
+      pid_t waitpid_result= waitpid(pid, &status, WNOHANG);
+      if ((waitpid_result == pid) || ((waitpid_result < 0) && (errno == ECHILD))) { is_reaped= 1; break; } /* ECHILD: SIGCHLD ignored */
+      if (poll_result == 0) continue;
+    }
+    if ((pfd[0].revents & POLLIN) == 0) continue;
+    memset(request, 0, sizes.seccomp_notif);
+    if (ioctl(listener_fd, SECCOMP_IOCTL_NOTIF_RECV, request) != 0)
+    {
+      if ((errno == EINTR) || (errno == ENOENT)) continue; /* ENOENT: the syscall was interrupted, nothing to answer */
+      break;
+    }
+    memset(response, 0, sizes.seccomp_notif_resp);
+    response->id= request->id;
+    response->flags= SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+    int arg_number= pgoptionfiles_tracer_arg_number(request->data.nr);
+    char file_name[PATH_MAX];
+    int copy_result= -1;
+    if ((arg_number >= 0) && (is_stopped == 0))
+      copy_result= pgoptionfiles_seccomp_copy_from_tracee(request->pid, ((pid_t) request->pid == pid) ? mem_fd : -1, file_name, request->data.args[arg_number]);
+    /* Check that the tracee is still waiting, i.e. file_name was read from the memory of the syscall that's waiting */
+    if ((copy_result > 0) && (ioctl(listener_fd, SECCOMP_IOCTL_NOTIF_ID_VALID, &request->id) == 0))
+    {
+      ++state.metrics.classified_stops;
+      if (is_metrics || (state.record_file != NULL))
+        state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+      state.last_entry_number= -1;
+      char canonical_name[PATH_MAX];
+      int canonical_length= 0;
+      if (state.is_connector_message_seen == 1)
+        canonical_length= pgoptionfiles_canonical(&state, request->pid, (arg_number == 1) ? (int) request->data.args[0] : AT_FDCWD, file_name, canonical_name);
+      if (canonical_length > 0) { memcpy(file_name, canonical_name, canonical_length + 1); copy_result= canonical_length; }
+      int file_name_result= pgoptionfiles_tracer_file_name(&state, file_name);
+      if (file_name_result == PGOPTIONFILES_FILE_NAME_STOP)
+      {
+        is_stopped= 1;
+        kill(pid, SIGKILL);
+      }
+      else if ((options->is_read == 0) && (file_name_result == PGOPTIONFILES_FILE_NAME_OPTION_FILE))
+      {
+        response->flags= 0;
+        response->error= -ENOENT;
+        if (state.last_entry_number >= 0)
+        {
+          file_names_list->entries[state.last_entry_number].syscall_result= -ENOENT;
+          file_names_list->entries[state.last_entry_number].is_denied= 1;
+        }
+      }
+      if (state.record_file != NULL)
+      {
+        struct pgoptionfiles_record record;
+        record.syscall_number= request->data.nr;
+        record.file_name_length= copy_result;
+        record.syscall_result= (response->flags == 0) ? response->error : -ENOSYS;
+        record.timestamp= state.timestamp;
+        pgoptionfiles_record_write(&state, &record, file_name);
+      }
+    }
+    /* ENOENT here means the tracee stopped waiting e.g. because it was killed, that's not a problem */
+    ioctl(listener_fd, SECCOMP_IOCTL_NOTIF_SEND, response);
+  }
+  free(request);
+  free(response);
+  if (mem_fd >= 0) close(mem_fd);
+  if (pid_fd >= 0) close(pid_fd);
+  close(listener_fd);
+  if (is_reaped == 0) while ((waitpid(pid, &status, 0) < 0) && (errno == EINTR)) {;}
+  if ((is_stopped == 0) && (state.retcode == 0))
+  {
+    if (WIFSIGNALED(status))
+    {
+      sprintf(error_list + strlen(error_list), "Error: tracee killed by signal %d.", WTERMSIG(status));
+      state.retcode= -2;
+    }
+  }
+  pgoptionfiles_record_close(&state);
+  state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+  pgoptionfiles_tracer_finish(&state);
+  return state.retcode;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* DLMOPEN BACKEND ***************
+  --backend dlmopen: no tracee process and no tracing. The library is loaded into this process, but in a new
+  link-map namespace (dlmopen(LM_ID_NEWLM)), so it and everything it needs, including a private copy of libc,
+  are separate from this program's. Then in every object of that namespace except libc and ld.so, each
+  R_..._JUMP_SLOT or R_..._GLOB_DAT relocation for a file-access function (open, fopen, access, stat etc.)
+  has its GOT slot overwritten with the address of a stub here. The stub does the same
+  pgoptionfiles_tracer_file_name() as the tracer, then either fails with ENOENT (as the default build's denial does)
+  or, with --read, calls the namespace's own function (what the slot held before it was patched, so e.g. a FILE *
+  comes from the same libc that will read it, and compat-only symbols such as __xstat, which dlsym() can't find
+  in glibc 2.33 and later, still work) and keeps the result. errno is the namespace's errno too, through its own
+  __errno_location(). The library is loaded with RTLD_NOW so that every slot holds the real function, not a
+  lazy-binding trampoline that would resolve and overwrite the slot. RELRO pages go back to read-only after patching.
+  glibc has only 16 namespaces and dlclose() doesn't always free one (e.g. if an object is NODELETE), so the
+  library stays loaded and patched for the next pgoptionfiles_run() with the same file, as with --watch or a
+  program that links pgoptionfiles in, and a different or changed library is loaded into the same namespace.
+  The tracee's messages aren't needed, pgoptionfiles_dlmopen_run() passes the same strings directly.
+  Limits: calls from inside libc aren't seen (e.g. if the connector used syscall() or a libc function that opens
+  files for it), objects that the connector dlopen()s later, e.g. plugins, aren't patched, and a crash in the
+  connector is a crash of this process. Only for x86_64 and aarch64, the relocation types are per architecture.
+*/
+
+#if defined(__x86_64__)
+#define PGOPTIONFILES_DLMOPEN_JUMP_SLOT R_X86_64_JUMP_SLOT
+#define PGOPTIONFILES_DLMOPEN_GLOB_DAT R_X86_64_GLOB_DAT
+#elif defined(__aarch64__)
+#define PGOPTIONFILES_DLMOPEN_JUMP_SLOT R_AARCH64_JUMP_SLOT
+#define PGOPTIONFILES_DLMOPEN_GLOB_DAT R_AARCH64_GLOB_DAT
+#endif
+
+static struct pgoptionfiles_state *pgoptionfiles_dlmopen_state; /* the stubs' only way to find the state */
+static int *(*pgoptionfiles_dlmopen_errno_location)(void); /* the namespace's libc has its own errno */
+
+/*
+  Pass: the directory fd argument of an intercepted call (AT_FDCWD if it has none), the file name argument
+  Return: 1 if the stub should fail with ENOENT, 0 if it should call the real function
+*/
+static int pgoptionfiles_dlmopen_file_name(int directory_fd, const char *file_name)
+{
+  struct pgoptionfiles_state *state= pgoptionfiles_dlmopen_state;
+  char canonical_name[PATH_MAX];
+  if ((state == NULL) || (file_name == NULL)) return 0;
+  ++state->metrics.classified_stops;
+  state->last_entry_number= -1;
+  if ((state->is_connector_message_seen == 1) && (pgoptionfiles_canonical(state, getpid(), directory_fd, file_name, canonical_name) > 0))
+    file_name= canonical_name;
+  int file_name_result= pgoptionfiles_tracer_file_name(state, file_name);
+  if ((state->options->is_read == 0) && (file_name_result != PGOPTIONFILES_FILE_NAME_IGNORE))
+  {
+    if (state->last_entry_number >= 0)
+    {
+      state->file_names_list->entries[state->last_entry_number].is_denied= 1;
+      state->file_names_list->entries[state->last_entry_number].syscall_result= -ENOENT;
+      state->last_entry_number= -1;
+    }
+    *pgoptionfiles_dlmopen_errno_location()= ENOENT;
+    return 1;
+  }
+  return 0;
+}
+
+/* After the real function: keep its result (0 or -errno) like a syscall exit would */
+static void pgoptionfiles_dlmopen_result(int is_failure)
+{
+  struct pgoptionfiles_state *state= pgoptionfiles_dlmopen_state;
+  if ((state == NULL) || (state->last_entry_number < 0)) return;
+  state->file_names_list->entries[state->last_entry_number].syscall_result= is_failure ? -*pgoptionfiles_dlmopen_errno_location() : 0;
+  state->last_entry_number= -1;
+}
+
+enum pgoptionfiles_dlmopen_function
+{
+  PGOPTIONFILES_DLMOPEN_OPEN, PGOPTIONFILES_DLMOPEN_OPEN_2, PGOPTIONFILES_DLMOPEN_OPENAT, PGOPTIONFILES_DLMOPEN_OPENAT_2,
+  PGOPTIONFILES_DLMOPEN_FOPEN, PGOPTIONFILES_DLMOPEN_ACCESS, PGOPTIONFILES_DLMOPEN_FACCESSAT,
+  PGOPTIONFILES_DLMOPEN_STAT, PGOPTIONFILES_DLMOPEN_LSTAT, PGOPTIONFILES_DLMOPEN_FSTATAT,
+  PGOPTIONFILES_DLMOPEN_XSTAT, PGOPTIONFILES_DLMOPEN_LXSTAT, PGOPTIONFILES_DLMOPEN_STATX, PGOPTIONFILES_DLMOPEN_OPENDIR,
+  PGOPTIONFILES_DLMOPEN_FUNCTION_COUNT
+};
+static void *pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_FUNCTION_COUNT]; /* the namespace's functions, for --read */
+
+/* What's loaded, kept between runs, see above */
+static void *pgoptionfiles_dlmopen_handle;
+static struct stat pgoptionfiles_dlmopen_library_stat;
+static char pgoptionfiles_dlmopen_library_name[PATH_MAX];
+static Lmid_t pgoptionfiles_dlmopen_namespace= LM_ID_NEWLM;
+static int pgoptionfiles_dlmopen_patch_count;
+
+static int pgoptionfiles_dlmopen_open(const char *file_name, int flags, ...)
+{
+  va_list ap;
+  va_start(ap, flags);
+  mode_t mode= (flags & (O_CREAT | O_TMPFILE)) ? va_arg(ap, mode_t) : 0;
+  va_end(ap);
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(const char *, int, ...)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_OPEN])(file_name, flags, mode);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_open_2(const char *file_name, int flags)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(const char *, int)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_OPEN_2])(file_name, flags);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_openat(int directory_fd, const char *file_name, int flags, ...)
+{
+  va_list ap;
+  va_start(ap, flags);
+  mode_t mode= (flags & (O_CREAT | O_TMPFILE)) ? va_arg(ap, mode_t) : 0;
+  va_end(ap);
+  if (pgoptionfiles_dlmopen_file_name(directory_fd, file_name)) return -1;
+  int result= ((int (*)(int, const char *, int, ...)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_OPENAT])(directory_fd, file_name, flags, mode);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_openat_2(int directory_fd, const char *file_name, int flags)
+{
+  if (pgoptionfiles_dlmopen_file_name(directory_fd, file_name)) return -1;
+  int result= ((int (*)(int, const char *, int)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_OPENAT_2])(directory_fd, file_name, flags);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static FILE *pgoptionfiles_dlmopen_fopen(const char *file_name, const char *mode)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return NULL;
+  FILE *result= ((FILE *(*)(const char *, const char *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_FOPEN])(file_name, mode);
+  pgoptionfiles_dlmopen_result(result == NULL);
+  return result;
+}
+static int pgoptionfiles_dlmopen_access(const char *file_name, int mode)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(const char *, int)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_ACCESS])(file_name, mode);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_faccessat(int directory_fd, const char *file_name, int mode, int flags)
+{
+  if (pgoptionfiles_dlmopen_file_name(directory_fd, file_name)) return -1;
+  int result= ((int (*)(int, const char *, int, int)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_FACCESSAT])(directory_fd, file_name, mode, flags);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_stat(const char *file_name, void *buffer)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(const char *, void *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_STAT])(file_name, buffer);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_lstat(const char *file_name, void *buffer)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(const char *, void *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_LSTAT])(file_name, buffer);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_fstatat(int directory_fd, const char *file_name, void *buffer, int flags)
+{
+  /* fstatat(fd, "", buffer, AT_EMPTY_PATH) is fstat(), not a file name */
+  if ((file_name != NULL) && (file_name[0] != '\0') && pgoptionfiles_dlmopen_file_name(directory_fd, file_name)) return -1;
+  int result= ((int (*)(int, const char *, void *, int)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_FSTATAT])(directory_fd, file_name, buffer, flags);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_xstat(int version, const char *file_name, void *buffer)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(int, const char *, void *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_XSTAT])(version, file_name, buffer);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_lxstat(int version, const char *file_name, void *buffer)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, file_name)) return -1;
+  int result= ((int (*)(int, const char *, void *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_LXSTAT])(version, file_name, buffer);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static int pgoptionfiles_dlmopen_statx(int directory_fd, const char *file_name, int flags, unsigned int mask, void *buffer)
+{
+  if ((file_name != NULL) && (file_name[0] != '\0') && pgoptionfiles_dlmopen_file_name(directory_fd, file_name)) return -1;
+  int result= ((int (*)(int, const char *, int, unsigned int, void *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_STATX])(directory_fd, file_name, flags, mask, buffer);
+  pgoptionfiles_dlmopen_result(result < 0);
+  return result;
+}
+static DIR *pgoptionfiles_dlmopen_opendir(const char *directory_name)
+{
+  if (pgoptionfiles_dlmopen_file_name(AT_FDCWD, directory_name)) return NULL;
+  DIR *result= ((DIR *(*)(const char *)) pgoptionfiles_dlmopen_real[PGOPTIONFILES_DLMOPEN_OPENDIR])(directory_name);
+  pgoptionfiles_dlmopen_result(result == NULL);
+  return result;
+}
+
+/* Symbol names that get a stub. The 64 names are the same functions as far as a 64-bit caller is concerned. */
+static const struct
+{
+  const char *name;
+  int function;
+  void *stub;
+} pgoptionfiles_dlmopen_stubs[]=
+{
+  {"open", PGOPTIONFILES_DLMOPEN_OPEN, (void *) pgoptionfiles_dlmopen_open},
+  {"open64", PGOPTIONFILES_DLMOPEN_OPEN, (void *) pgoptionfiles_dlmopen_open},
+  {"__open_2", PGOPTIONFILES_DLMOPEN_OPEN_2, (void *) pgoptionfiles_dlmopen_open_2},
+  {"__open64_2", PGOPTIONFILES_DLMOPEN_OPEN_2, (void *) pgoptionfiles_dlmopen_open_2},
+  {"openat", PGOPTIONFILES_DLMOPEN_OPENAT, (void *) pgoptionfiles_dlmopen_openat},
+  {"openat64", PGOPTIONFILES_DLMOPEN_OPENAT, (void *) pgoptionfiles_dlmopen_openat},
+  {"__openat_2", PGOPTIONFILES_DLMOPEN_OPENAT_2, (void *) pgoptionfiles_dlmopen_openat_2},
+  {"__openat64_2", PGOPTIONFILES_DLMOPEN_OPENAT_2, (void *) pgoptionfiles_dlmopen_openat_2},
+  {"fopen", PGOPTIONFILES_DLMOPEN_FOPEN, (void *) pgoptionfiles_dlmopen_fopen},
+  {"fopen64", PGOPTIONFILES_DLMOPEN_FOPEN, (void *) pgoptionfiles_dlmopen_fopen},
+  {"access", PGOPTIONFILES_DLMOPEN_ACCESS, (void *) pgoptionfiles_dlmopen_access},
+  {"faccessat", PGOPTIONFILES_DLMOPEN_FACCESSAT, (void *) pgoptionfiles_dlmopen_faccessat},
+  {"stat", PGOPTIONFILES_DLMOPEN_STAT, (void *) pgoptionfiles_dlmopen_stat},
+  {"stat64", PGOPTIONFILES_DLMOPEN_STAT, (void *) pgoptionfiles_dlmopen_stat},
+  {"lstat", PGOPTIONFILES_DLMOPEN_LSTAT, (void *) pgoptionfiles_dlmopen_lstat},
+  {"lstat64", PGOPTIONFILES_DLMOPEN_LSTAT, (void *) pgoptionfiles_dlmopen_lstat},
+  {"fstatat", PGOPTIONFILES_DLMOPEN_FSTATAT, (void *) pgoptionfiles_dlmopen_fstatat},
+  {"fstatat64", PGOPTIONFILES_DLMOPEN_FSTATAT, (void *) pgoptionfiles_dlmopen_fstatat},
+  {"__xstat", PGOPTIONFILES_DLMOPEN_XSTAT, (void *) pgoptionfiles_dlmopen_xstat},
+  {"__xstat64", PGOPTIONFILES_DLMOPEN_XSTAT, (void *) pgoptionfiles_dlmopen_xstat},
+  {"__lxstat", PGOPTIONFILES_DLMOPEN_LXSTAT, (void *) pgoptionfiles_dlmopen_lxstat},
+  {"__lxstat64", PGOPTIONFILES_DLMOPEN_LXSTAT, (void *) pgoptionfiles_dlmopen_lxstat},
+  {"statx", PGOPTIONFILES_DLMOPEN_STATX, (void *) pgoptionfiles_dlmopen_statx},
+  {"opendir", PGOPTIONFILES_DLMOPEN_OPENDIR, (void *) pgoptionfiles_dlmopen_opendir}
+};
+#define PGOPTIONFILES_DLMOPEN_STUB_COUNT (sizeof(pgoptionfiles_dlmopen_stubs) / sizeof(pgoptionfiles_dlmopen_stubs[0]))
+
+#ifdef PGOPTIONFILES_DLMOPEN_JUMP_SLOT
+/* dl_iterate_phdr() callback: find the PT_GNU_RELRO range of the object whose l_addr is range[0] */
+static int pgoptionfiles_dlmopen_relro_callback(struct dl_phdr_info *info, size_t size, void *data)
+{
+  ElfW(Addr) *range= data;
+  (void) size;
+  if (info->dlpi_addr != range[0]) return 0;
+  for (int i= 0; i < info->dlpi_phnum; ++i)
+  {
+    if (info->dlpi_phdr[i].p_type != PT_GNU_RELRO) continue;
+    range[1]= info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+    range[2]= range[1] + info->dlpi_phdr[i].p_memsz;
+  }
+  return 1;
+}
+
+/*
+  Pass: one object of the namespace
+  Do: point its GOT slots for the stub table's names at the stubs, keeping what they held in pgoptionfiles_dlmopen_real[]
+  Return: number of slots changed
+*/
+static int pgoptionfiles_dlmopen_patch(const struct link_map *map)
+{
+  const ElfW(Sym) *symbols= NULL;
+  const char *strings= NULL;
+  const ElfW(Rela) *relocations[2]= {NULL, NULL}; /* DT_JMPREL, DT_RELA */
+  size_t relocations_sizes[2]= {0, 0};
+  long page_size= sysconf(_SC_PAGESIZE);
+  int patch_count= 0;
+  for (const ElfW(Dyn) *dyn= map->l_ld; dyn->d_tag != DT_NULL; ++dyn)
+  {
+    /* ld.so relocates these pointers in place on most architectures, but not all, so check */
+    ElfW(Addr) address= dyn->d_un.d_ptr;
+    if (address < map->l_addr) address+= map->l_addr;
+    if (dyn->d_tag == DT_SYMTAB) symbols= (const ElfW(Sym) *) address;
+    else if (dyn->d_tag == DT_STRTAB) strings= (const char *) address;
+    else if (dyn->d_tag == DT_JMPREL) relocations[0]= (const ElfW(Rela) *) address;
+    else if (dyn->d_tag == DT_PLTRELSZ) relocations_sizes[0]= dyn->d_un.d_val;
+    else if (dyn->d_tag == DT_RELA) relocations[1]= (const ElfW(Rela) *) address;
+    else if (dyn->d_tag == DT_RELASZ) relocations_sizes[1]= dyn->d_un.d_val;
+  }
+  if ((symbols == NULL) || (strings == NULL)) return 0;
+  /* ld.so makes whole pages of RELRO read-only, i.e. from the page that it starts in to the page that it ends in */
+  ElfW(Addr) relro[3]= {map->l_addr, 0, 0};
+  dl_iterate_phdr(pgoptionfiles_dlmopen_relro_callback, relro);
+  relro[1]&= ~(ElfW(Addr)) (page_size - 1);
+  relro[2]&= ~(ElfW(Addr)) (page_size - 1);
+  for (int table= 0; table < 2; ++table)
+  {
+    if (relocations[table] == NULL) continue;
+    for (size_t i= 0; i < relocations_sizes[table] / sizeof(ElfW(Rela)); ++i)
+    {
+      const ElfW(Rela) *relocation= &relocations[table][i];
+#if (__SIZEOF_POINTER__ == 8)
+      unsigned long type= ELF64_R_TYPE(relocation->r_info), symbol_number= ELF64_R_SYM(relocation->r_info);
+#else
+      unsigned long type= ELF32_R_TYPE(relocation->r_info), symbol_number= ELF32_R_SYM(relocation->r_info);
+#endif
+      if (((type != PGOPTIONFILES_DLMOPEN_JUMP_SLOT) && (type != PGOPTIONFILES_DLMOPEN_GLOB_DAT)) || (symbol_number == 0)) continue;
+      const char *name= strings + symbols[symbol_number].st_name;
+      for (size_t j= 0; j < PGOPTIONFILES_DLMOPEN_STUB_COUNT; ++j)
+      {
+        if (strcmp(name, pgoptionfiles_dlmopen_stubs[j].name) != 0) continue;
+        void **slot= (void **) (map->l_addr + relocation->r_offset);
+        void *page= (void *) ((size_t) slot & ~(size_t) (page_size - 1));
+        int is_relro= (((ElfW(Addr)) slot >= relro[1]) && ((ElfW(Addr)) slot < relro[2]));
+        if (*slot == NULL) break; /* weak and undefined */
+        if (*slot == pgoptionfiles_dlmopen_stubs[j].stub) { ++patch_count; break; } /* still patched from a last load */
+        if (is_relro && (mprotect(page, page_size, PROT_READ | PROT_WRITE) != 0)) break;
+        int function= pgoptionfiles_dlmopen_stubs[j].function;
+        if (pgoptionfiles_dlmopen_real[function] == NULL) pgoptionfiles_dlmopen_real[function]= *slot;
+        *slot= pgoptionfiles_dlmopen_stubs[j].stub;
+        if (is_relro) mprotect(page, page_size, PROT_READ);
+        ++patch_count;
+        break;
+      }
+    }
+  }
+  return patch_count;
+}
+#endif
+
+#ifdef PGOPTIONFILES_DLMOPEN_JUMP_SLOT
+/* dlclose() what's loaded, the namespace number is kept for the next load */
+static void pgoptionfiles_dlmopen_unload(void)
+{
+  if (pgoptionfiles_dlmopen_handle != NULL) dlclose(pgoptionfiles_dlmopen_handle);
+  pgoptionfiles_dlmopen_handle= NULL;
+  pgoptionfiles_dlmopen_library_name[0]= '\0';
+  pgoptionfiles_dlmopen_patch_count= 0;
+}
+
+/*
+  Pass: library name, error_list
+  Do: reuse the loaded library if it's the same file and unchanged, else dlmopen() it into the namespace
+      of the last one (or a new namespace if there's no last one or it's gone) and patch the namespace
+  Return: handle, or NULL (with "Error: ..." appended to error_list)
+*/
+static void *pgoptionfiles_dlmopen_load(const char *library_name, char *error_list)
+{
+  struct stat library_stat;
+  memset(&library_stat, 0, sizeof(library_stat));
+  int is_stat= (stat(library_name, &library_stat) == 0);
+  if ((pgoptionfiles_dlmopen_handle != NULL) && is_stat
+   && (strcmp(library_name, pgoptionfiles_dlmopen_library_name) == 0)
+   && (library_stat.st_dev == pgoptionfiles_dlmopen_library_stat.st_dev)
+   && (library_stat.st_ino == pgoptionfiles_dlmopen_library_stat.st_ino)
+   && (library_stat.st_size == pgoptionfiles_dlmopen_library_stat.st_size)
+   && (library_stat.st_mtim.tv_sec == pgoptionfiles_dlmopen_library_stat.st_mtim.tv_sec)
+   && (library_stat.st_mtim.tv_nsec == pgoptionfiles_dlmopen_library_stat.st_mtim.tv_nsec))
+    return pgoptionfiles_dlmopen_handle;
+  pgoptionfiles_dlmopen_unload();
+  void *dlopen_handle= NULL;
+  if (pgoptionfiles_dlmopen_namespace != LM_ID_NEWLM)
+    dlopen_handle= dlmopen(pgoptionfiles_dlmopen_namespace, library_name, RTLD_NOW | RTLD_LOCAL);
+  if (dlopen_handle == NULL)
+    dlopen_handle= dlmopen(LM_ID_NEWLM, library_name, RTLD_NOW | RTLD_LOCAL);
+  if ((dlopen_handle == NULL) || (strlen(library_name) >= sizeof(pgoptionfiles_dlmopen_library_name)))
+  {
+    if (dlopen_handle != NULL) dlclose(dlopen_handle);
+    strcat(error_list, "Error: dlmopen() failed --does library exist and is it Connector C?");
+    return NULL;
+  }
+  if (dlinfo(dlopen_handle, RTLD_DI_LMID, &pgoptionfiles_dlmopen_namespace) != 0)
+    pgoptionfiles_dlmopen_namespace= LM_ID_NEWLM;
+  /* A different libc means a new or emptied namespace, so the saved functions are stale */
+  int *(*errno_location)(void)= (int *(*)(void)) dlsym(dlopen_handle, "__errno_location");
+  if (errno_location == NULL) errno_location= __errno_location;
+  if (errno_location != pgoptionfiles_dlmopen_errno_location)
+    for (int i= 0; i < PGOPTIONFILES_DLMOPEN_FUNCTION_COUNT; ++i) pgoptionfiles_dlmopen_real[i]= NULL;
+  pgoptionfiles_dlmopen_errno_location= errno_location;
+  /* The namespace's objects are a list, the library might not be first. Objects still patched from a last load are skipped */
+  struct link_map *map= NULL;
+  int patch_count= 0;
+  if (dlinfo(dlopen_handle, RTLD_DI_LINKMAP, &map) == 0)
+  {
+    while (map->l_prev != NULL) map= map->l_prev;
+    for (; map != NULL; map= map->l_next)
+    {
+      if ((map->l_name == NULL) || (map->l_name[0] == '\0') || (strstr(map->l_name, "/libc.so") != NULL)
+       || (strstr(map->l_name, "/ld-linux") != NULL) || (strstr(map->l_name, "/ld64.so") != NULL))
+        continue;
+      patch_count+= pgoptionfiles_dlmopen_patch(map);
+    }
+  }
+  pgoptionfiles_dlmopen_handle= dlopen_handle;
+  strcpy(pgoptionfiles_dlmopen_library_name, library_name);
+  pgoptionfiles_dlmopen_library_stat= library_stat;
+  pgoptionfiles_dlmopen_patch_count= patch_count;
+  return dlopen_handle;
+}
+#endif
+
+/*
+  Pass: the usual buffers, options
+  Do: what pgoptionfiles_tracee() + pgoptionfiles_tracer() do, in this process
+  Return: 0 ok, < 0 error (with "Error: ..." appended to error_list)
+*/
+int pgoptionfiles_dlmopen_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_state state;
+  char message[sizeof("(Connector query ") + PGOPTIONFILES_QUERY_LABEL_SIZE];
+  memset(&state, 0, sizeof(state));
+  state.options= options;
+  state.file_names_list= file_names_list;
+  state.last_entry_number= -1;
+  state.error_list= error_list;
+  clock_gettime(CLOCK_MONOTONIC, &state.start_time);
+#ifndef PGOPTIONFILES_DLMOPEN_JUMP_SLOT
+  strcat(error_list, "Error: --backend dlmopen isn't supported for this architecture.");
+  return -1;
+#else
+  /* Before the load, so the load row counts it. Only the first run with a library loads it, see above. */
+  pgoptionfiles_perf_open(&state, 0); /* the connector runs in the tracer, so there's only a tracer row */
+  void *dlopen_handle= pgoptionfiles_dlmopen_load(options->library_name, error_list);
+  if (dlopen_handle == NULL) { pgoptionfiles_perf_close(&state); return -6; }
+  MYSQL *(*t__mysql_init)(MYSQL *)= (MYSQL *(*)(MYSQL *)) dlsym(dlopen_handle, "mysql_init");
+  const char *(*t__mysql_get_client_info)(void)= (const char *(*)(void)) dlsym(dlopen_handle, "mysql_get_client_info");
+  int (*t__mysql_options)(MYSQL *, enum mysql_option, const void *)= (int (*)(MYSQL *, enum mysql_option, const void *)) dlsym(dlopen_handle, "mysql_options");
+  MYSQL *(*t__mysql_real_connect)(MYSQL *, const char *, const char *, const char *, const char *, unsigned int, const char *, unsigned long)=
+    (MYSQL *(*)(MYSQL *, const char *, const char *, const char *, const char *, unsigned int, const char *, unsigned long)) dlsym(dlopen_handle, "mysql_real_connect");
+  void (*t__mysql_close)(MYSQL *)= (void (*)(MYSQL *)) dlsym(dlopen_handle, "mysql_close");
+  if ((t__mysql_init == NULL) || (t__mysql_get_client_info == NULL) || (t__mysql_options == NULL)
+   || (t__mysql_real_connect == NULL) || (t__mysql_close == NULL))
+  {
+    pgoptionfiles_dlmopen_unload();
+    pgoptionfiles_perf_close(&state);
+    strcat(error_list, "Error: dlsym() failed -- is this a Connector C library?");
+    return -6;
+  }
+  if (pgoptionfiles_dlmopen_patch_count == 0)
+  {
+    pgoptionfiles_dlmopen_unload();
+    pgoptionfiles_perf_close(&state);
+    strcat(error_list, "Error: --backend dlmopen found no file-access calls to intercept in the library.");
+    return -6;
+  }
+  pgoptionfiles_dlmopen_state= &state;
+  MYSQL *mysql= t__mysql_init(NULL);
+  if (mysql == NULL) { strcat(error_list, "Error: mysql_init() failed -- out of memory?"); state.retcode= -6; }
+  else
+  {
+    const char *client_info= t__mysql_get_client_info();
+    snprintf(message, sizeof(message), "(Connector C version %.200s)", (client_info != NULL) ? client_info : "unknown");
+    state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time); /* the end of the load phase */
+    pgoptionfiles_tracer_file_name(&state, message);
+  }
+  struct pgoptionfiles_query default_query= {"client", NULL};
+  const struct pgoptionfiles_query *queries= (options->query_count == 0) ? &default_query : options->queries;
+  int query_count= (options->query_count == 0) ? 1 : options->query_count;
+  for (int query_number= 0; (query_number < query_count) && (state.retcode == 0); ++query_number)
+  {
+    if ((query_number > 0) && ((mysql= t__mysql_init(NULL)) == NULL))
+    {
+      strcat(error_list, "Error: mysql_init() failed -- out of memory?");
+      state.retcode= -6;
+      break;
+    }
+    if (options->query_count > 0)
+    {
+      if (queries[query_number].file == NULL) sprintf(message, "(Connector query %s", queries[query_number].group);
+      else sprintf(message, "(Connector query %s,%s", queries[query_number].group, queries[query_number].file);
+      pgoptionfiles_tracer_file_name(&state, message);
+    }
+    if ((t__mysql_options(mysql, MYSQL_READ_DEFAULT_GROUP, queries[query_number].group) == 1)
+     || ((queries[query_number].file != NULL) && (t__mysql_options(mysql, MYSQL_READ_DEFAULT_FILE, queries[query_number].file) == 1)))
+    {
+      strcat(error_list, "Error: mysql_options() failed -- bad syntax in an option file?");
+      state.retcode= -6;
+    }
+    else
+    {
+      state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+      pgoptionfiles_tracer_file_name(&state, "(Connector phase connect");
+      if (t__mysql_real_connect(mysql, "localhost", "", "", "", 3309, NULL, 0) != 0)
+        strcat(error_list, "Error: mysql_real_connect() succeeded -- this is probably harmless.");
+      state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+      pgoptionfiles_tracer_file_name(&state, "(Connector phase close");
+    }
+    t__mysql_close(mysql);
+  }
+  pgoptionfiles_dlmopen_state= NULL; /* the library stays loaded, see above */
+  state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+  pgoptionfiles_tracer_finish(&state);
+  return state.retcode;
+#endif
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* ATTACH ***************
+  --pid PID. Seize every thread of a running process, and threads it makes later (PTRACE_O_TRACECLONE),
+  without PTRACE_O_EXITKILL and without ever changing a syscall, so it's only watched.
+  Names are classified by pgoptionfiles_tracer_file_name() as if "(Connector ..." had been seen, except that
+  only names ending in ".cnf" count, because there are no tracee messages to say when the connector is busy.
+  Threads stop independently, so each has its own pending entry, and PTRACE_GET_SYSCALL_INFO (Linux 5.3)
+  says whether a stop is entry or exit -- counting doesn't work for a thread seized in the middle of a syscall.
+  The window ends PGOPTIONFILES_ATTACH_QUIET_MILLISECONDS after the latest option file, or PGOPTIONFILES_ATTACH_SECONDS
+  after attaching if there's no option file, or when the process ends. A SIGALRM tick breaks waitpid() to check.
+  Then each thread is interrupted and detached, passing on any signal that it was stopped for.
+  waitpid(-1) and the process-wide SIGALRM handler and timer belong to pgoptionfiles only in the program, so
+  a PGOPTIONFILES_LIBRARY build says "Error: --pid is not possible ..." instead of taking the host's.
+*/
+
+struct pgoptionfiles_attach_thread
+{
+  pid_t tid;
+  int last_entry_number;          /* like state.last_entry_number, for this thread's syscall in progress */
+  int is_record_pending;
+  struct pgoptionfiles_record record;
+  char *record_file_name;         /* malloc()ed if is_record_pending */
+};
+
+static void pgoptionfiles_attach_alarm(int signal_number)
+{
+  (void) signal_number; /* it only has to interrupt waitpid() */
+}
+
+/* Return: the thread's slot, added if is_add and not there, or NULL */
+static struct pgoptionfiles_attach_thread *pgoptionfiles_attach_thread(struct pgoptionfiles_attach_thread **threads, int *thread_count, pid_t tid, int is_add)
+{
+  for (int i= 0; i < *thread_count; ++i) if ((*threads)[i].tid == tid) return &(*threads)[i];
+  if (!is_add) return NULL;
+  struct pgoptionfiles_attach_thread *new_threads= realloc(*threads, (*thread_count + 1) * sizeof(struct pgoptionfiles_attach_thread));
+  if (new_threads == NULL) return NULL;
+  *threads= new_threads;
+  struct pgoptionfiles_attach_thread *thread= &new_threads[(*thread_count)++];
+  memset(thread, 0, sizeof(*thread));
+  thread->tid= tid;
+  thread->last_entry_number= -1;
+  return thread;
+}
+
+/* Return: number of threads newly seized from /proc/PID/task, or -1 if none could be and there were none before */
+static int pgoptionfiles_attach_seize(pid_t pid, struct pgoptionfiles_attach_thread **threads, int *thread_count)
+{
+  char task_directory_name[64];
+  sprintf(task_directory_name, "/proc/%d/task", (int) pid);
+  DIR *task_directory= opendir(task_directory_name);
+  if (task_directory == NULL) return -1;
+  int seized_count= 0;
+  struct dirent *task;
+  while ((task= readdir(task_directory)) != NULL)
+  {
+    pid_t tid= (pid_t) atoi(task->d_name);
+    if ((tid <= 0) || (pgoptionfiles_attach_thread(threads, thread_count, tid, 0) != NULL)) continue;
+    if ((ptrace(PTRACE_SEIZE, tid, NULL, (void *) (long) (PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE)) < 0)
+     || (ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) < 0))
+      continue; /* e.g. it just ended */
+    if (pgoptionfiles_attach_thread(threads, thread_count, tid, 1) == NULL) break;
+    ++seized_count;
+  }
+  closedir(task_directory);
+  return ((seized_count == 0) && (*thread_count == 0)) ? -1 : seized_count;
+}
+
+/*
+  Pass: the usual buffers, options with attach_pid
+  Do: as described for the ATTACH section
+  Return: 0 ok, < 0 error (with "Error: ..." appended to error_list)
+*/
+int pgoptionfiles_attach(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+#if (PGOPTIONFILES_LIBRARY == 1)
+  /* waitpid(-1) would reap the host's own children and SIGALRM would take over its timer, see ATTACH */
+  strcat(error_list, "Error: --pid is not possible in a PGOPTIONFILES_LIBRARY build.");
+  return -1;
+#endif
+  pid_t pid= options->attach_pid;
+  struct pgoptionfiles_state state;
+  memset(&state, 0, sizeof(state));
+  state.options= options;
+  state.file_names_list= file_names_list;
+  state.last_entry_number= -1;
+  state.error_list= error_list;
+  state.is_connector_message_seen= 1;
+  state.phase= PGOPTIONFILES_PHASE_OPTIONS;
+  state.fd_cache= malloc(sizeof(*state.fd_cache)); /* threads share fds, so one cache, and if NULL it's just slower */
+  if (state.fd_cache != NULL) state.fd_cache->count= state.fd_cache->next= 0;
+  sprintf(error_list + strlen(error_list), "(pid %d)", (int) pid);
+  clock_gettime(CLOCK_MONOTONIC, &state.start_time);
+  struct pgoptionfiles_attach_thread *threads= NULL;
+  int thread_count= 0;
+  /* Threads made while this is going on are seized by PTRACE_O_TRACECLONE if their creator was seized, so repeat till none are new */
+  int seize_result;
+  while ((seize_result= pgoptionfiles_attach_seize(pid, &threads, &thread_count)) > 0) {;}
+  if (seize_result < 0)
+  {
+    strcat(error_list, "Error: ptrace(PTRACE_SEIZE) failed -- does the process exist, and is ptrace() allowed?");
+    free(threads);
+    free(state.fd_cache);
+    return -3;
+  }
+  pgoptionfiles_perf_open(&state, pid); /* only its main thread */
+  if (pgoptionfiles_record_open(&state) != 0) state.retcode= -1; /* still detach below */
+  else if (state.record_file != NULL)
+  {
+    /* so --replay knows it's from --pid, i.e. nothing was denied and there are no tracee messages */
+    struct pgoptionfiles_record marker;
+    char marker_name[64];
+    memset(&marker, 0, sizeof(marker));
+    marker.syscall_number= SYS_openat;
+    marker.file_name_length= sprintf(marker_name, "(Connector pid %d)", (int) pid);
+    marker.syscall_result= -ENOENT;
+    pgoptionfiles_record_write(&state, &marker, marker_name);
+  }
+  struct sigaction alarm_action, old_alarm_action;
+  struct itimerval tick, old_tick;
+  memset(&alarm_action, 0, sizeof(alarm_action));
+  alarm_action.sa_handler= pgoptionfiles_attach_alarm; /* no SA_RESTART */
+  sigaction(SIGALRM, &alarm_action, &old_alarm_action);
+  memset(&tick, 0, sizeof(tick));
+  tick.it_interval.tv_usec= tick.it_value.tv_usec= 100000;
+  setitimer(ITIMER_REAL, &tick, &old_tick);
+  int64_t deadline= (int64_t) PGOPTIONFILES_ATTACH_SECONDS * 1000000000;
+  pid_t stopped_tid= 0; /* the thread that's stopped and not resumed when the loop ends, if any */
+  int stopped_signal= 0;
+  while ((state.retcode == 0) && (thread_count > 0))
+  {
+    int status;
+    pid_t tid= waitpid(-1, &status, __WALL);
+    state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+    if (tid < 0)
+    {
+      if (errno == EINTR) { if (state.timestamp >= deadline) break; continue; }
+      break; /* ECHILD, nothing is traced any more */
+    }
+    struct pgoptionfiles_attach_thread *thread= pgoptionfiles_attach_thread(&threads, &thread_count, tid, 0);
+    if (WIFEXITED(status) || WIFSIGNALED(status))
+    {
+      if (thread != NULL)
+      {
+        if (thread->is_record_pending) { pgoptionfiles_record_write(&state, &thread->record, thread->record_file_name); free(thread->record_file_name); }
+        *thread= threads[--thread_count];
+      }
+      continue;
+    }
+    if (thread == NULL) thread= pgoptionfiles_attach_thread(&threads, &thread_count, tid, 1); /* made by a seized thread */
+    int resume_signal= 0;
+    int event= status >> 16;
+    if (WSTOPSIG(status) == (SIGTRAP | 0x80))
+    {
+      struct __ptrace_syscall_info info;
+      ++state.metrics.syscall_stops;
+      if ((thread != NULL)
+       && (ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void *) sizeof(info), &info) > 0))
+      {
+        if (info.op == PTRACE_SYSCALL_INFO_ENTRY)
+        {
+          PGOPTIONFILES_PROBE2(syscall_entry, tid, info.entry.nr);
+          int arg_number= pgoptionfiles_tracer_arg_number(info.entry.nr);
+          PGOPTIONFILES_PROBE3(classify, tid, info.entry.nr, arg_number);
+          pgoptionfiles_fd_cache_syscall(&state, info.entry.nr, info.entry.args[0], info.entry.args[1]);
+          if (arg_number >= 0)
+          {
+            char file_name[PATH_MAX];
+            char canonical_name[PATH_MAX];
+            int copy_result= pgoptionfiles_copy_from_tracee(tid, file_name, (const char *) (size_t) info.entry.args[arg_number]);
+            state.metrics.peekdata_calls+= 1 + copy_result / sizeof(size_t);
+            int canonical_length= 0;
+            if (copy_result > 0)
+              canonical_length= pgoptionfiles_canonical(&state, tid, (arg_number == 1) ? (int) info.entry.args[0] : AT_FDCWD, file_name, canonical_name);
+            if (canonical_length > 0) { memcpy(file_name, canonical_name, canonical_length + 1); copy_result= canonical_length; }
+            /* the tracee can't send messages, and a name like "Error: x.cnf" mustn't look like one */
+            if ((copy_result > 4) && (strcmp(file_name + copy_result - 4, ".cnf") == 0)
+             && (strncmp(file_name, "Error: ", sizeof("Error: ") - 1) != 0) && (strncmp(file_name, "(Connector ", sizeof("(Connector ") - 1) != 0))
+            {
+              ++state.metrics.classified_stops;
+              state.last_entry_number= -1;
+              if (pgoptionfiles_tracer_file_name(&state, file_name) == PGOPTIONFILES_FILE_NAME_STOP)
+              {
+                stopped_tid= tid; /* overflow. This thread is in its entry stop, so it's detached from there */
+                stopped_signal= 0;
+                break;
+              }
+              thread->last_entry_number= state.last_entry_number;
+              if ((state.record_file != NULL) && (thread->is_record_pending == 0)
+               && ((thread->record_file_name= malloc(copy_result)) != NULL))
+              {
+                thread->record.syscall_number= info.entry.nr;
+                thread->record.file_name_length= copy_result;
+                thread->record.syscall_result= -ENOSYS;
+                thread->record.timestamp= state.timestamp;
+                memcpy(thread->record_file_name, file_name, copy_result);
+                thread->is_record_pending= 1;
+              }
+              deadline= state.timestamp + (int64_t) PGOPTIONFILES_ATTACH_QUIET_MILLISECONDS * 1000000;
+            }
+          }
+        }
+        else if (info.op == PTRACE_SYSCALL_INFO_EXIT)
+        {
+          if (thread->last_entry_number >= 0)
+          {
+            file_names_list->entries[thread->last_entry_number].syscall_result= info.exit.rval;
+            thread->last_entry_number= -1;
+          }
+          if (thread->is_record_pending)
+          {
+            thread->record.syscall_result= info.exit.rval;
+            pgoptionfiles_record_write(&state, &thread->record, thread->record_file_name);
+            free(thread->record_file_name);
+            thread->is_record_pending= 0;
+          }
+        }
+      }
+    }
+    else if (event == PTRACE_EVENT_STOP)
+    {
+      /* PTRACE_INTERRUPT's stop, a new thread's first stop, or a group-stop, which should stay stopped */
+      siginfo_t siginfo;
+      if (((WSTOPSIG(status) == SIGSTOP) || (WSTOPSIG(status) == SIGTSTP) || (WSTOPSIG(status) == SIGTTIN) || (WSTOPSIG(status) == SIGTTOU))
+       && (ptrace(PTRACE_GETSIGINFO, tid, NULL, &siginfo) < 0) && (errno == EINVAL))
+      {
+        ptrace(PTRACE_LISTEN, tid, NULL, NULL);
+        continue;
+      }
+    }
+    else if (event == 0) resume_signal= WSTOPSIG(status); /* signal-delivery-stop, pass it on */
+    if (state.timestamp >= deadline) { stopped_tid= tid; stopped_signal= resume_signal; break; }
+    ptrace(PTRACE_SYSCALL, tid, NULL, (void *) (long) resume_signal);
+  }
+  setitimer(ITIMER_REAL, &old_tick, NULL);
+  sigaction(SIGALRM, &old_alarm_action, NULL);
+  /* Detach. Anything but the stopped thread is running or in a syscall, interrupt it and wait for any stop. */
+  for (int i= 0; i < thread_count; ++i)
+  {
+    pid_t tid= threads[i].tid;
+    int detach_signal= 0;
+    if (tid == stopped_tid) detach_signal= stopped_signal;
+    else
+    {
+      int status;
+      if (ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) < 0) continue;
+      while ((waitpid(tid, &status, __WALL) < 0) && (errno == EINTR)) {;}
+      if (!WIFSTOPPED(status)) continue;
+      if (((status >> 16) == 0) && (WSTOPSIG(status) != (SIGTRAP | 0x80))) detach_signal= WSTOPSIG(status);
+    }
+    ptrace(PTRACE_DETACH, tid, NULL, (void *) (long) detach_signal);
+    if (threads[i].is_record_pending) { pgoptionfiles_record_write(&state, &threads[i].record, threads[i].record_file_name); free(threads[i].record_file_name); }
+  }
+  free(threads);
+  pgoptionfiles_record_close(&state);
+  state.timestamp= pgoptionfiles_nanoseconds_since(&state.start_time);
+  pgoptionfiles_tracer_finish(&state);
+  if ((state.retcode == 0) && (file_names_list->entry_count == 0))
+    strcat(error_list, "(no option files were read while attached)");
+  return state.retcode;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* VERIFY ***************
+  --verify. The paths are every entry's file name and every distinct directory of those, all statx()'d at once.
+  io_uring is set up with raw syscalls (no liburing), with a ring of PGOPTIONFILES_VERIFY_RING_SIZE, so there's
+  one io_uring_enter() per ring-full. If io_uring_setup() fails (old kernel, or disabled by sysctl or seccomp)
+  or a completion says -EINVAL (kernel without IORING_OP_STATX), that path gets a plain statx().
+  With --root the tracee saw DIR as /, so each path is opened with openat2(RESOLVE_IN_ROOT) (Linux 5.6+) under DIR
+  and its O_PATH fd is statx()'d with AT_EMPTY_PATH. An absolute symlink in the image then resolves in the image,
+  not on the host. If io_uring_enter() fails part way, whatever the kernel already took is waited for before the
+  ring is freed. If even that fails, the statx buffers are leaked rather than freed under the kernel.
+*/
+
+#define PGOPTIONFILES_VERIFY_RING_SIZE 256
+
+struct pgoptionfiles_verify_ring
+{
+  int fd;
+  unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+  unsigned int *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;                  /* == sq_ring if IORING_FEAT_SINGLE_MMAP */
+  size_t cq_ring_size;
+  size_t sqes_size;
+};
+
+/* Return: 0 ok, -1 no io_uring so use plain statx() */
+static int pgoptionfiles_verify_ring_init(struct pgoptionfiles_verify_ring *ring)
+{
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd= syscall(SYS_io_uring_setup, PGOPTIONFILES_VERIFY_RING_SIZE, &params);
+  if (ring->fd < 0) return -1;
+  ring->sq_ring_size= params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  ring->cq_ring_size= params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size= ring->cq_ring_size;
+    ring->cq_ring_size= ring->sq_ring_size;
+  }
+  ring->sq_ring= mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) { close(ring->fd); return -1; }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) ring->cq_ring= ring->sq_ring;
+  else
+  {
+    ring->cq_ring= mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) { munmap(ring->sq_ring, ring->sq_ring_size); close(ring->fd); return -1; }
+  }
+  ring->sqes_size= params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes= mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED)
+  {
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+    return -1;
+  }
+  char *sq= ring->sq_ring, *cq= ring->cq_ring;
+  ring->sq_head= (unsigned int *) (sq + params.sq_off.head);
+  ring->sq_tail= (unsigned int *) (sq + params.sq_off.tail);
+  ring->sq_mask= (unsigned int *) (sq + params.sq_off.ring_mask);
+  ring->sq_array= (unsigned int *) (sq + params.sq_off.array);
+  ring->cq_head= (unsigned int *) (cq + params.cq_off.head);
+  ring->cq_tail= (unsigned int *) (cq + params.cq_off.tail);
+  ring->cq_mask= (unsigned int *) (cq + params.cq_off.ring_mask);
+  ring->cqes= (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+  return 0;
+}
+
+static void pgoptionfiles_verify_ring_free(struct pgoptionfiles_verify_ring *ring)
+{
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+  munmap(ring->sq_ring, ring->sq_ring_size);
+  close(ring->fd);
+}
+
+/* Do: take what's in the completion queue, results[user_data]= res. Return: how many. */
+static unsigned int pgoptionfiles_verify_ring_reap(struct pgoptionfiles_verify_ring *ring, int *results, unsigned int path_count)
+{
+  unsigned int reaped= 0;
+  unsigned int head= *ring->cq_head;
+  unsigned int cq_tail= __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != cq_tail; ++head, ++reaped)
+  {
+    const struct io_uring_cqe *cqe= &ring->cqes[head & *ring->cq_mask];
+    if (cqe->user_data < path_count) results[cqe->user_data]= cqe->res;
+  }
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+  return reaped;
+}
+
+/*
+  Pass: paths, count, --root DIR's fd or -1, statx buffers and result codes to fill (0 or -errno)
+  Do: statx(AT_FDCWD, path, 0, STATX_TYPE|STATX_SIZE|STATX_MTIME) for each, with io_uring if possible.
+      With root_fd, each path is first opened with openat2(root_fd, path, O_PATH, RESOLVE_IN_ROOT), so absolute
+      paths and symlinks resolve inside the image as they did for the chrooted tracee, then the fd is statx()'d.
+  Return: 0, or 1 if io_uring_enter() failed with statx()s still in flight, so buffers mustn't be freed
+*/
+static int pgoptionfiles_verify_statx(char **paths, unsigned int path_count, int root_fd, struct statx *buffers, int *results)
+{
+  const unsigned int mask= STATX_TYPE | STATX_SIZE | STATX_MTIME;
+  struct pgoptionfiles_verify_ring ring;
+  unsigned int pending_count= 0;
+  int is_in_flight= 0;
+  int *fds= NULL;
+  unsigned int *pending= malloc((path_count + 1) * sizeof(unsigned int));
+  if (root_fd >= 0) fds= malloc((path_count + 1) * sizeof(int));
+  if ((pending == NULL) || ((root_fd >= 0) && (fds == NULL)))
+  {
+    for (unsigned int i= 0; i < path_count; ++i) results[i]= -ENOMEM;
+    free(pending);
+    free(fds);
+    return 0;
+  }
+  for (unsigned int i= 0; i < path_count; ++i)
+  {
+    results[i]= -EINVAL;
+    if (root_fd >= 0)
+    {
+      struct open_how how;
+      memset(&how, 0, sizeof(how));
+      how.flags= O_PATH | O_CLOEXEC;
+      how.resolve= RESOLVE_IN_ROOT;
+      fds[i]= syscall(SYS_openat2, root_fd, paths[i], &how, sizeof(how));
+      if (fds[i] < 0) { results[i]= -errno; continue; }
+    }
+    pending[pending_count++]= i;
+  }
+  if ((pending_count > 0) && (pgoptionfiles_verify_ring_init(&ring) == 0))
+  {
+    unsigned int done= 0;
+    while (done < pending_count)
+    {
+      unsigned int batch= pending_count - done;
+      if (batch > PGOPTIONFILES_VERIFY_RING_SIZE) batch= PGOPTIONFILES_VERIFY_RING_SIZE;
+      unsigned int tail= *ring.sq_tail;
+      for (unsigned int k= 0; k < batch; ++k)
+      {
+        unsigned int i= pending[done + k];
+        unsigned int index= (tail + k) & *ring.sq_mask;
+        struct io_uring_sqe *sqe= &ring.sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode= IORING_OP_STATX;
+        sqe->fd= (root_fd >= 0) ? fds[i] : AT_FDCWD;
+        sqe->addr= (unsigned long) ((root_fd >= 0) ? "" : paths[i]);
+        sqe->len= mask;
+        sqe->off= (unsigned long) &buffers[i];
+        sqe->statx_flags= (root_fd >= 0) ? AT_EMPTY_PATH : 0;
+        sqe->user_data= i;
+        ring.sq_array[index]= index;
+      }
+      __atomic_store_n(ring.sq_tail, tail + batch, __ATOMIC_RELEASE);
+      unsigned int completed= 0;
+      while (completed < batch)
+      {
+        if (syscall(SYS_io_uring_enter, ring.fd, (completed == 0) ? batch : 0, batch - completed, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+        {
+          if (errno == EINTR) continue;
+          break;
+        }
+        completed+= pgoptionfiles_verify_ring_reap(&ring, results, path_count);
+      }
+      if (completed < batch)
+      {
+        /*
+          What the kernel took from the submission queue may still be running and writing to buffers.
+          Wait for those, and if that fails too, leave buffers alone. The rest keep -EINVAL, so plain statx() below.
+        */
+        unsigned int submitted= __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) - tail;
+        completed+= pgoptionfiles_verify_ring_reap(&ring, results, path_count);
+        while (completed < submitted)
+        {
+          if ((syscall(SYS_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) && (errno != EINTR)) break;
+          completed+= pgoptionfiles_verify_ring_reap(&ring, results, path_count);
+        }
+        if (completed < submitted) is_in_flight= 1;
+        break;
+      }
+      done+= batch;
+    }
+    pgoptionfiles_verify_ring_free(&ring);
+  }
+  for (unsigned int k= 0; k < pending_count; ++k)
+  {
+    unsigned int i= pending[k];
+    if (results[i] != -EINVAL) continue;
+    /* not straight into buffers[i], which an in-flight statx() may still be writing to */
+    struct statx statx_buffer;
+    if (root_fd >= 0) results[i]= (statx(fds[i], "", AT_EMPTY_PATH, mask, &statx_buffer) == 0) ? 0 : -errno;
+    else results[i]= (statx(AT_FDCWD, paths[i], 0, mask, &statx_buffer) == 0) ? 0 : -errno;
+    if (results[i] == 0) buffers[i]= statx_buffer;
+  }
+  if (root_fd >= 0) for (unsigned int k= 0; k < pending_count; ++k) close(fds[pending[k]]);
+  free(pending);
+  free(fds);
+  return is_in_flight;
+}
+
+/*
+  Pass: list, --root DIR or NULL
+  Do: fill in each entry's stat_errno, size, mtime, directory_errno, set list->is_verified
+  Return: 0 ok, -1 out of memory (list->is_verified stays 0)
+*/
+int pgoptionfiles_verify(struct pgoptionfiles_list *list, const char *root_directory)
+{
+  unsigned int entry_count= list->entry_count;
+  /* paths[0 .. entry_count-1] are the entries, then the distinct directories. directory_numbers[i] is entry i's. */
+  char **paths= calloc(entry_count * 2 + 1, sizeof(char *));
+  unsigned int *directory_numbers= malloc((entry_count + 1) * sizeof(unsigned int));
+  struct statx *buffers= malloc((entry_count * 2 + 1) * sizeof(struct statx));
+  int *results= malloc((entry_count * 2 + 1) * sizeof(int));
+  unsigned int path_count= 0;
+  int result= -1;
+  int is_in_flight= 0;
+  int root_fd= -1;
+  if ((paths == NULL) || (directory_numbers == NULL) || (buffers == NULL) || (results == NULL)) goto end;
+  if ((root_directory != NULL) && ((root_fd= open(root_directory, O_PATH | O_DIRECTORY | O_CLOEXEC)) < 0)) goto end;
+  for (unsigned int i= 0; i < entry_count; ++i)
+  {
+    const char *name= PGOPTIONFILES_LIST_NAME(list, i);
+    paths[path_count]= strdup(name); /* with --root it's looked up inside root_fd, not as DIR/name */
+    if (paths[path_count] == NULL) goto end;
+    ++path_count;
+  }
+  for (unsigned int i= 0; i < entry_count; ++i)
+  {
+    const char *slash= strrchr(paths[i], '/');
+    size_t directory_length= (slash == NULL) ? 1 : (slash == paths[i]) ? 1 : (size_t) (slash - paths[i]);
+    const char *directory= (slash == NULL) ? "." : paths[i];
+    unsigned int j;
+    for (j= entry_count; j < path_count; ++j)
+      if ((strlen(paths[j]) == directory_length) && (memcmp(paths[j], directory, directory_length) == 0)) break;
+    if (j == path_count)
+    {
+      paths[path_count]= malloc(directory_length + 1);
+      if (paths[path_count] == NULL) goto end;
+      memcpy(paths[path_count], directory, directory_length);
+      paths[path_count][directory_length]= '\0';
+      ++path_count;
+    }
+    directory_numbers[i]= j;
+  }
+  is_in_flight= pgoptionfiles_verify_statx(paths, path_count, root_fd, buffers, results);
+  for (unsigned int i= 0; i < entry_count; ++i)
+  {
+    struct pgoptionfiles_entry *entry= &list->entries[i];
+    entry->stat_errno= -results[i];
+    entry->size= (results[i] == 0) ? (long long) buffers[i].stx_size : 0;
+    entry->mtime= (results[i] == 0) ? (long long) buffers[i].stx_mtime.tv_sec : 0;
+    unsigned int j= directory_numbers[i];
+    entry->directory_errno= ((results[j] == 0) && !S_ISDIR(buffers[j].stx_mode)) ? ENOTDIR : -results[j];
+  }
+  list->is_verified= 1;
+  result= 0;
+end:
+  if (root_fd >= 0) close(root_fd);
+  if (paths != NULL) for (unsigned int i= 0; i < path_count; ++i) free(paths[i]);
+  free(paths);
+  free(directory_numbers);
+  if (is_in_flight == 0) free(buffers); /* else leaked, the kernel may still write to it */
+  free(results);
+  return result;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* FILE NAMES LIST ***************
+  Duplicates are found with an open-addressing hash table (FNV-1a), so the cost per file name doesn't depend
+  on how many file names there are already.
+*/
+
+void pgoptionfiles_list_init(struct pgoptionfiles_list *list)
+{
+  memset(list, 0, sizeof(*list));
+  list->stream_fd= -1;
+}
+
+static int pgoptionfiles_output_writev(int fd, struct iovec *iov, int iov_count); /* it's in the OUTPUT section */
+
+/*
+  Pass: list, a --query label or NULL
+  Do: if list->stream_fd >= 0, write every entry not written yet as "F" is-denied syscall-result " " file-name '\0',
+  then if query_label "Q" query-label '\0'. See the ASYNC section.
+  Call it when the entries so far are complete, i.e. before adding another, before a new query, and at the end.
+*/
+void pgoptionfiles_list_stream(struct pgoptionfiles_list *list, const char *query_label)
+{
+  if (list->stream_fd < 0) return;
+  for (; list->stream_count < list->entry_count; ++list->stream_count)
+  {
+    const struct pgoptionfiles_entry *entry= &list->entries[list->stream_count];
+    char header[64];
+    struct iovec iov[2];
+    iov[0].iov_base= header;
+    iov[0].iov_len= sprintf(header, "F%d %ld ", entry->is_denied, entry->syscall_result);
+    iov[1].iov_base= (void *) PGOPTIONFILES_LIST_NAME(list, list->stream_count);
+    iov[1].iov_len= entry->name_length + 1;
+    if (pgoptionfiles_output_writev(list->stream_fd, iov, 2) != 0) { list->stream_fd= -1; return; }
+  }
+  if (query_label != NULL)
+  {
+    struct iovec iov[2];
+    iov[0].iov_base= (void *) "Q";
+    iov[0].iov_len= 1;
+    iov[1].iov_base= (void *) query_label;
+    iov[1].iov_len= strlen(query_label) + 1;
+    if (pgoptionfiles_output_writev(list->stream_fd, iov, 2) != 0) list->stream_fd= -1;
+  }
+}
+
+void pgoptionfiles_list_free(struct pgoptionfiles_list *list)
+{
+  free(list->names);
+  free(list->entries);
+  free(list->hash_table);
+  memset(list, 0, sizeof(*list));
+  list->stream_fd= -1;
+}
+
+static unsigned int pgoptionfiles_list_hash(const char *file_name, size_t file_name_length)
+{
+  unsigned int hash= 2166136261u;
+  for (size_t i= 0; i < file_name_length; ++i) { hash^= (unsigned char) file_name[i]; hash*= 16777619u; }
+  return hash;
+}
+
+/* Return: entry number, or -1 if not in list */
+int pgoptionfiles_list_find(const struct pgoptionfiles_list *list, const char *file_name, size_t file_name_length)
+{
+  if (list->hash_table_size == 0) return -1;
+  unsigned int mask= list->hash_table_size - 1;
+  for (unsigned int slot= pgoptionfiles_list_hash(file_name, file_name_length) & mask; ; slot= (slot + 1) & mask)
+  {
+    unsigned int entry_number_plus_1= list->hash_table[slot];
+    if (entry_number_plus_1 == 0) return -1;
+    const struct pgoptionfiles_entry *entry= &list->entries[entry_number_plus_1 - 1];
+    if ((entry->name_length == file_name_length) && (entry->query_number == list->query_number) && (memcmp(list->names + entry->name_offset, file_name, file_name_length) == 0))
+      return entry_number_plus_1 - 1;
+  }
+}
+
+/*
+  Pass: list, file name
+  Do: add at end if it's not already there. syscall_result is -ENOSYS until caller knows better.
+  Return: new entry number, or -1 if it's a duplicate, or -2 if too big (PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE) or out of memory
+*/
+int pgoptionfiles_list_add(struct pgoptionfiles_list *list, const char *file_name, size_t file_name_length)
+{
+  if (pgoptionfiles_list_find(list, file_name, file_name_length) >= 0) return -1;
+  if (list->names_size + file_name_length + 1 > PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE) return -2;
+  if (list->names_size + file_name_length + 1 > list->names_allocated)
+  {
+    size_t new_size= (list->names_allocated == 0) ? 4096 : list->names_allocated * 2;
+    while (new_size < list->names_size + file_name_length + 1) new_size*= 2;
+    char *new_names= realloc(list->names, new_size);
+    if (new_names == NULL) return -2;
+    list->names= new_names;
+    list->names_allocated= new_size;
+  }
+  if (list->entry_count == list->entries_allocated)
+  {
+    unsigned int new_count= (list->entries_allocated == 0) ? 64 : list->entries_allocated * 2;
+    struct pgoptionfiles_entry *new_entries= realloc(list->entries, new_count * sizeof(struct pgoptionfiles_entry));
+    if (new_entries == NULL) return -2;
+    list->entries= new_entries;
+    list->entries_allocated= new_count;
+  }
+  /* Keep the hash table at most half full */
+  if ((list->entry_count + 1) * 2 > list->hash_table_size)
+  {
+    unsigned int new_size= (list->hash_table_size == 0) ? 128 : list->hash_table_size * 2;
+    unsigned int *new_hash_table= calloc(new_size, sizeof(unsigned int));
+    if (new_hash_table == NULL) return -2;
+    for (unsigned int i= 0; i < list->entry_count; ++i)
+    {
+      unsigned int slot= pgoptionfiles_list_hash(PGOPTIONFILES_LIST_NAME(list, i), list->entries[i].name_length) & (new_size - 1);
+      while (new_hash_table[slot] != 0) slot= (slot + 1) & (new_size - 1);
+      new_hash_table[slot]= i + 1;
+    }
+    free(list->hash_table);
+    list->hash_table= new_hash_table;
+    list->hash_table_size= new_size;
+  }
+  struct pgoptionfiles_entry *entry= &list->entries[list->entry_count];
+  entry->name_offset= list->names_size;
+  entry->name_length= file_name_length;
+  entry->syscall_result= -ENOSYS;
+  entry->is_denied= 0;
+  entry->query_number= list->query_number;
+  memcpy(list->names + list->names_size, file_name, file_name_length);
+  list->names[list->names_size + file_name_length]= '\0';
+  list->names_size+= file_name_length + 1;
+  unsigned int slot= pgoptionfiles_list_hash(file_name, file_name_length) & (list->hash_table_size - 1);
+  while (list->hash_table[slot] != 0) slot= (slot + 1) & (list->hash_table_size - 1);
+  list->hash_table[slot]= list->entry_count + 1;
+  return list->entry_count++;
+}
+
+/*
+  ******************* OUTPUT ***************
+  --format newline   (default) error_list, newline, file names separated by --delimiter, newline
+  --format nul       error_list, '\0', then each file name followed by '\0'
+  --format json      {"pgoptionfiles":"error_list","retcode":n,"files":[{"name":"file-name","status":"status"},...]}
+  --format csv       name,status header, then "error_list",message (or error if retcode != 0), then file-name,status
+  status is from pgoptionfiles_entry_status().
+  If --query: newline and nul have a "(pgoptionfiles)(query group[,file])" line before each query's file names,
+  json has "query":"group[,file]" in each file object, csv has a third column, query.
+  If --verify: json has "exists":true|false,"size":n,"mtime":n,"directory_exists":true|false in each file object,
+  csv has those four columns last.
+  Everything is written with writev() straight from the list, at most PGOPTIONFILES_IOV_MAX pieces per call,
+  so ordinarily there is just one call. Only names that JSON or CSV must escape are copied.
+*/
+
+#define PGOPTIONFILES_IOV_MAX 1024
+
+/* Return: "ok", "denied" (tracer made it fail), "unknown" (syscall exit not seen), or errno name e.g. "ENOENT" */
+const char *pgoptionfiles_entry_status(const struct pgoptionfiles_entry *entry)
+{
+  if (entry->is_denied) return "denied";
+  if (entry->syscall_result >= 0) return "ok";
+  switch (-entry->syscall_result)
+  {
+  case ENOSYS: return "unknown";
+  case ENOENT: return "ENOENT";
+  case EACCES: return "EACCES";
+  case EPERM: return "EPERM";
+  case ENOTDIR: return "ENOTDIR";
+  case ELOOP: return "ELOOP";
+  case ENAMETOOLONG: return "ENAMETOOLONG";
+  case EISDIR: return "EISDIR";
+  case EIO: return "EIO";
+  default: return "error";
+  }
+}
+
+/*
+  Pass: output buffer or NULL (to just get length), string + length, 1 = JSON string contents or 0 = CSV field
+  Return: length of escaped string, or 0 if it needs no escaping
+*/
+static size_t pgoptionfiles_output_escape(char *out, const char *in, size_t in_length, int is_json)
+{
+  size_t out_length= 0;
+  int is_escape_needed= 0;
+  for (size_t i= 0; i < in_length; ++i)
+  {
+    unsigned char c= (unsigned char) in[i];
+    if (is_json && ((c == '"') || (c == '\\') || (c < 0x20))) is_escape_needed= 1;
+    if (!is_json && ((c == '"') || (c == ',') || (c == '\n') || (c == '\r'))) is_escape_needed= 1;
+  }
+  if (!is_escape_needed) return 0;
+  if (!is_json) { if (out) out[out_length]= '"'; ++out_length; }
+  for (size_t i= 0; i < in_length; ++i)
+  {
+    unsigned char c= (unsigned char) in[i];
+    if (is_json && ((c == '"') || (c == '\\'))) { if (out) { out[out_length]= '\\'; out[out_length + 1]= c; } out_length+= 2; }
+    else if (is_json && (c < 0x20)) { if (out) sprintf(out + out_length, "\\u%04x", c); out_length+= 6; }
+    else if (!is_json && (c == '"')) { if (out) { out[out_length]= '"'; out[out_length + 1]= '"'; } out_length+= 2; }
+    else { if (out) out[out_length]= c; ++out_length; }
+  }
+  if (!is_json) { if (out) out[out_length]= '"'; ++out_length; }
+  return out_length;
+}
+
+/* writev() everything, PGOPTIONFILES_IOV_MAX at a time, continuing after partial writes. Return: 0 ok, -1 error */
+static int pgoptionfiles_output_writev(int fd, struct iovec *iov, int iov_count)
+{
+  while (iov_count > 0)
+  {
+    int batch= (iov_count < PGOPTIONFILES_IOV_MAX) ? iov_count : PGOPTIONFILES_IOV_MAX;
+    ssize_t written= writev(fd, iov, batch);
+    if (written < 0) { if (errno == EINTR) continue; return -1; }
+    while ((iov_count > 0) && ((size_t) written >= iov->iov_len)) { written-= iov->iov_len; ++iov; --iov_count; }
+    if (written > 0) { iov->iov_base= (char *) iov->iov_base + written; iov->iov_len-= written; }
+  }
+  return 0;
+}
+
+/*
+  Pass: fd e.g. STDOUT_FILENO, list, error_list, retcode, format (NULL means newline), --delimiter for newline format
+  Do: write as described above
+  Return: 0 ok, -1 error
+*/
+int pgoptionfiles_output(int fd, const struct pgoptionfiles_list *file_names_list, const char *error_list, int retcode, const char *format,
+                         char delimiter_character)
+{
+  const char delimiter[1]= {delimiter_character};
+  const struct pgoptionfiles_list *list= file_names_list;
+  int is_json= ((format != NULL) && (strcmp(format, "json") == 0));
+  int is_csv= ((format != NULL) && (strcmp(format, "csv") == 0));
+  int is_nul= ((format != NULL) && (strcmp(format, "nul") == 0));
+  struct iovec *iov= malloc((list->entry_count * 8 + list->query_count * 4 + 8) * sizeof(struct iovec));
+  if (iov == NULL) return -1;
+  int n= 0;
+#define PGOPTIONFILES_IOV(base, length) { iov[n].iov_base= (void *) (base); iov[n].iov_len= (length); ++n; }
+  if (is_nul)
+  {
+    PGOPTIONFILES_IOV(error_list, strlen(error_list) + 1);
+    if (list->query_count == 0) PGOPTIONFILES_IOV(list->names, list->names_size) /* already file-name\0file-name\0... */
+    else
+    {
+      unsigned int i= 0;
+      for (unsigned int q= 0; q < list->query_count; ++q)
+      {
+        PGOPTIONFILES_IOV("(pgoptionfiles)(query ", sizeof("(pgoptionfiles)(query ") - 1);
+        PGOPTIONFILES_IOV(list->query_labels[q], strlen(list->query_labels[q]));
+        PGOPTIONFILES_IOV(")", 2); /* ")\0" */
+        for (; (i < list->entry_count) && (list->entries[i].query_number == q); ++i)
+          PGOPTIONFILES_IOV(PGOPTIONFILES_LIST_NAME(list, i), list->entries[i].name_length + 1);
+      }
+    }
+  }
+  else if (!is_json && !is_csv)
+  {
+    PGOPTIONFILES_IOV(error_list, strlen(error_list));
+    PGOPTIONFILES_IOV("\n", 1);
+    unsigned int i= 0;
+    /* Without --query this is one pass of the outer loop with no "(query ...)" line */
+    for (unsigned int q= 0; (q < list->query_count) || ((q == 0) && (list->query_count == 0)); ++q)
+    {
+      if (list->query_count > 0)
+      {
+        PGOPTIONFILES_IOV("(pgoptionfiles)(query ", sizeof("(pgoptionfiles)(query ") - 1);
+        PGOPTIONFILES_IOV(list->query_labels[q], strlen(list->query_labels[q]));
+        PGOPTIONFILES_IOV(")\n", 2);
+      }
+      for (unsigned int first= i; (i < list->entry_count) && (list->entries[i].query_number == q); ++i)
+      {
+        if (i > first) PGOPTIONFILES_IOV(delimiter, 1);
+        PGOPTIONFILES_IOV(PGOPTIONFILES_LIST_NAME(list, i), list->entries[i].name_length);
+      }
+      PGOPTIONFILES_IOV("\n", 1);
+    }
+  }
+  int result= 0;
+  char *escapes= NULL;
+  if (is_json || is_csv)
+  {
+    /* One pass to size the escape buffer, one to fill it */
+    size_t escapes_size= pgoptionfiles_output_escape(NULL, error_list, strlen(error_list), is_json) + 1;
+    for (unsigned int i= 0; i < list->entry_count; ++i)
+      escapes_size+= pgoptionfiles_output_escape(NULL, PGOPTIONFILES_LIST_NAME(list, i), list->entries[i].name_length, is_json);
+    for (unsigned int q= 0; q < list->query_count; ++q)
+      escapes_size+= pgoptionfiles_output_escape(NULL, list->query_labels[q], strlen(list->query_labels[q]), is_json);
+    if (list->is_verified) escapes_size+= list->entry_count * 96; /* room for each entry's --verify text */
+    escapes= malloc(escapes_size + 64);
+    if (escapes == NULL) { free(iov); return -1; }
+    char *retcode_string= escapes + escapes_size;
+    size_t escapes_used= 0;
+    size_t escaped_length= pgoptionfiles_output_escape(escapes, error_list, strlen(error_list), is_json);
+    const char *error_list_out= error_list;
+    size_t error_list_out_length= strlen(error_list);
+    if (escaped_length > 0) { error_list_out= escapes; error_list_out_length= escaped_length; escapes_used+= escaped_length; }
+    const char *labels_out[PGOPTIONFILES_MAX_QUERIES];
+    size_t label_out_lengths[PGOPTIONFILES_MAX_QUERIES];
+    for (unsigned int q= 0; q < list->query_count; ++q)
+    {
+      labels_out[q]= list->query_labels[q];
+      label_out_lengths[q]= strlen(list->query_labels[q]);
+      escaped_length= pgoptionfiles_output_escape(escapes + escapes_used, labels_out[q], label_out_lengths[q], is_json);
+      if (escaped_length > 0) { labels_out[q]= escapes + escapes_used; label_out_lengths[q]= escaped_length; escapes_used+= escaped_length; }
+    }
+    if (is_json)
+    {
+      PGOPTIONFILES_IOV("{\"pgoptionfiles\":\"", sizeof("{\"pgoptionfiles\":\"") - 1);
+      PGOPTIONFILES_IOV(error_list_out, error_list_out_length);
+      sprintf(retcode_string, "\",\"retcode\":%d,\"files\":[", retcode);
+      PGOPTIONFILES_IOV(retcode_string, strlen(retcode_string));
+    }
+    else
+    {
+      PGOPTIONFILES_IOV("name,status", sizeof("name,status") - 1);
+      if (list->query_count > 0) PGOPTIONFILES_IOV(",query", sizeof(",query") - 1)
+      if (list->is_verified) PGOPTIONFILES_IOV(",exists,size,mtime,directory_exists", sizeof(",exists,size,mtime,directory_exists") - 1)
+      PGOPTIONFILES_IOV("\n", 1);
+      PGOPTIONFILES_IOV(error_list_out, error_list_out_length);
+      if (retcode == 0) PGOPTIONFILES_IOV(",message", sizeof(",message") - 1)
+      else PGOPTIONFILES_IOV(",error", sizeof(",error") - 1)
+      if (list->query_count > 0) PGOPTIONFILES_IOV(",", 1)
+      if (list->is_verified) PGOPTIONFILES_IOV(",,,,", 4)
+      PGOPTIONFILES_IOV("\n", 1);
+    }
+    for (unsigned int i= 0; i < list->entry_count; ++i)
+    {
+      const char *name= PGOPTIONFILES_LIST_NAME(list, i);
+      size_t name_length= list->entries[i].name_length;
+      unsigned int q= list->entries[i].query_number;
+      escaped_length= pgoptionfiles_output_escape(escapes + escapes_used, name, name_length, is_json);
+      if (escaped_length > 0) { name= escapes + escapes_used; name_length= escaped_length; escapes_used+= escaped_length; }
+      const char *status= pgoptionfiles_entry_status(&list->entries[i]);
+      if (is_json)
+      {
+        if (i == 0) PGOPTIONFILES_IOV("{\"name\":\"", sizeof("{\"name\":\"") - 1)
+        else PGOPTIONFILES_IOV(",{\"name\":\"", sizeof(",{\"name\":\"") - 1)
+        PGOPTIONFILES_IOV(name, name_length);
+        PGOPTIONFILES_IOV("\",\"status\":\"", sizeof("\",\"status\":\"") - 1);
+        PGOPTIONFILES_IOV(status, strlen(status));
+        if (list->query_count > 0)
+        {
+          PGOPTIONFILES_IOV("\",\"query\":\"", sizeof("\",\"query\":\"") - 1);
+          PGOPTIONFILES_IOV(labels_out[q], label_out_lengths[q]);
+        }
+        PGOPTIONFILES_IOV("\"", 1);
+        if (list->is_verified)
+        {
+          const struct pgoptionfiles_entry *entry= &list->entries[i];
+          char *verify_string= escapes + escapes_used;
+          escapes_used+= sprintf(verify_string, ",\"exists\":%s,\"size\":%lld,\"mtime\":%lld,\"directory_exists\":%s",
+                                 (entry->stat_errno == 0) ? "true" : "false", entry->size, entry->mtime,
+                                 (entry->directory_errno == 0) ? "true" : "false");
+          PGOPTIONFILES_IOV(verify_string, escapes + escapes_used - verify_string);
+        }
+        PGOPTIONFILES_IOV("}", 1);
+      }
+      else
+      {
+        PGOPTIONFILES_IOV(name, name_length);
+        PGOPTIONFILES_IOV(",", 1);
+        PGOPTIONFILES_IOV(status, strlen(status));
+        if (list->query_count > 0)
+        {
+          PGOPTIONFILES_IOV(",", 1);
+          PGOPTIONFILES_IOV(labels_out[q], label_out_lengths[q]);
+        }
+        if (list->is_verified)
+        {
+          const struct pgoptionfiles_entry *entry= &list->entries[i];
+          char *verify_string= escapes + escapes_used;
+          escapes_used+= sprintf(verify_string, ",%d,%lld,%lld,%d", (entry->stat_errno == 0), entry->size, entry->mtime, (entry->directory_errno == 0));
+          PGOPTIONFILES_IOV(verify_string, escapes + escapes_used - verify_string);
+        }
+        PGOPTIONFILES_IOV("\n", 1);
+      }
+    }
+    if (is_json) PGOPTIONFILES_IOV("]}\n", 3);
+  }
+#undef PGOPTIONFILES_IOV
+  result= pgoptionfiles_output_writev(fd, iov, n);
+  free(escapes);
+  free(iov);
+  return result;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* WORKERS AND DIFF ***************
+  A worker is a child process that does pgoptionfiles_run() and writes the result to a pipe:
+  error_list '\0', then "Q" query-label '\0' for each --query, then for each file name
+  "query-number is-denied syscall-result " file-name '\0'. That's --format nul plus what's needed to rebuild the list.
+  So several libraries can be traced at the same time, each with its own tracer, in identical environments.
+*/
+
+/*
+  Pass: options (library_name etc. for this worker), address of int for the read end of the pipe
+  Do: fork a worker
+  Return: worker pid, or -1 if fork() or pipe() failed
+*/
+pid_t pgoptionfiles_worker_start(const struct pgoptionfiles_options *options, int *read_fd)
+{
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) return -1;
+  pid_t pid= fork();
+  if (pid < 0) { close(pipe_fds[0]); close(pipe_fds[1]); return -1; }
+  if (pid == 0)
+  {
+    struct pgoptionfiles_list file_names_list;
+    char error_list[4096]= "(pgoptionfiles)";
+    close(pipe_fds[0]);
+    pgoptionfiles_list_init(&file_names_list);
+    int result_code= pgoptionfiles_run(&file_names_list, error_list, options);
+    FILE *fp= fdopen(pipe_fds[1], "wb");
+    if (fp == NULL) _exit(result_code & 0xff);
+    pgoptionfiles_worker_write(fp, &file_names_list, error_list);
+    fclose(fp);
+    _exit(result_code & 0xff);
+  }
+  close(pipe_fds[1]);
+  *read_fd= pipe_fds[0];
+  return pid;
+}
+
+/* Do: write error_list and file_names_list in the worker format, see above. The caller checks ferror() or fclose(). */
+void pgoptionfiles_worker_write(FILE *fp, const struct pgoptionfiles_list *file_names_list, const char *error_list)
+{
+  fwrite(error_list, 1, strlen(error_list) + 1, fp);
+  for (unsigned int q= 0; q < file_names_list->query_count; ++q)
+    fprintf(fp, "Q%s%c", file_names_list->query_labels[q], '\0');
+  for (unsigned int i= 0; i < file_names_list->entry_count; ++i)
+  {
+    const struct pgoptionfiles_entry *entry= &file_names_list->entries[i];
+    fprintf(fp, "%u %d %ld ", entry->query_number, entry->is_denied, entry->syscall_result);
+    fwrite(PGOPTIONFILES_LIST_NAME(file_names_list, i), 1, entry->name_length + 1, fp);
+  }
+}
+
+/*
+  Pass: what pgoptionfiles_worker_write() wrote, an initialized list, error_list buffer
+  Do: rebuild error_list and the list. If the list has a stream_fd, entries and query labels go to it as well,
+      in the order a tracer would have sent them, i.e. each query's label before its first entry.
+  Return: 0 ok, -1 if there's no error_list, i.e. nothing was written
+*/
+int pgoptionfiles_worker_parse(const char *buffer, size_t buffer_length, struct pgoptionfiles_list *file_names_list, char *error_list, size_t error_list_size)
+{
+  unsigned int streamed_query_count= 0;
+  if (memchr(buffer, '\0', buffer_length) == NULL) return -1;
+  snprintf(error_list, error_list_size, "%s", buffer);
+  for (size_t offset= strlen(buffer) + 1; offset < buffer_length; )
+  {
+    const char *item= buffer + offset;
+    const char *nul= memchr(item, '\0', buffer_length - offset);
+    if (nul == NULL) break;
+    offset= (nul - buffer) + 1;
+    if (*item == 'Q')
+    {
+      if (file_names_list->query_count == PGOPTIONFILES_MAX_QUERIES) continue;
+      snprintf(file_names_list->query_labels[file_names_list->query_count], PGOPTIONFILES_QUERY_LABEL_SIZE, "%s", item + 1);
+      file_names_list->query_number= file_names_list->query_count++;
+      continue;
+    }
+    unsigned int query_number;
+    int is_denied, prefix_length= 0;
+    long syscall_result;
+    if ((sscanf(item, "%u %d %ld %n", &query_number, &is_denied, &syscall_result, &prefix_length) != 3) || (prefix_length == 0)) continue;
+    if ((query_number > 0) && (query_number >= file_names_list->query_count)) continue;
+    while ((streamed_query_count <= query_number) && (streamed_query_count < file_names_list->query_count))
+      pgoptionfiles_list_stream(file_names_list, file_names_list->query_labels[streamed_query_count++]);
+    file_names_list->query_number= query_number;
+    int entry_number= pgoptionfiles_list_add(file_names_list, item + prefix_length, nul - (item + prefix_length));
+    if (entry_number < 0) continue;
+    file_names_list->entries[entry_number].is_denied= is_denied;
+    file_names_list->entries[entry_number].syscall_result= syscall_result;
+  }
+  while (streamed_query_count < file_names_list->query_count)
+    pgoptionfiles_list_stream(file_names_list, file_names_list->query_labels[streamed_query_count++]);
+  pgoptionfiles_list_stream(file_names_list, NULL);
+  return 0;
+}
+
+/*
+  Pass: worker pid and read_fd from pgoptionfiles_worker_start(), an initialized list, error_list buffer
+  Do: read what the worker wrote, wait for it to end
+  Return: the worker's pgoptionfiles_run() result, or -1 if it failed, ended without output, or wrote
+          more than the buffer holds (then error_list says so and the list has only what fit)
+*/
+int pgoptionfiles_worker_finish(pid_t pid, int read_fd, struct pgoptionfiles_list *file_names_list, char *error_list, size_t error_list_size)
+{
+  size_t buffer_size= 4096 + PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE;
+  char *buffer= malloc(buffer_size);
+  size_t buffer_length= 0;
+  int is_truncated= 0;
+  for (;;)
+  {
+    if (buffer == NULL) break;
+    ssize_t read_result= read(read_fd, buffer + buffer_length, buffer_size - 1 - buffer_length);
+    if (read_result < 0 && errno == EINTR) continue;
+    if (read_result <= 0) break;
+    buffer_length+= read_result;
+    if (buffer_length == buffer_size - 1)
+    {
+      /* Full. If there's even one more byte the rest is lost, which the caller must hear about. */
+      char extra;
+      while ((read_result= read(read_fd, &extra, 1)) < 0 && errno == EINTR) {;}
+      is_truncated= (read_result > 0);
+      break;
+    }
+  }
+  close(read_fd);
+  int status= 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {;}
+  if ((buffer == NULL) || (pgoptionfiles_worker_parse(buffer, buffer_length, file_names_list, error_list, error_list_size) != 0))
+  {
+    free(buffer);
+    snprintf(error_list, error_list_size, "(pgoptionfiles)Error: worker ended without output.");
+    return -1;
+  }
+  free(buffer);
+  if (is_truncated)
+  {
+    size_t error_list_length= strlen(error_list);
+    snprintf(error_list + error_list_length, error_list_size - error_list_length,
+             "Error: worker output is more than %zu bytes, the rest of the list is missing.", buffer_size - 1);
+    return -1;
+  }
+  if (!WIFEXITED(status)) return -1;
+  return (int) (signed char) WEXITSTATUS(status);
+}
+
+/*
+  Pass: options for each job (usually differing only in library_name or root_directory), a label for each job, count
+  Do: run the jobs in workers, at most number-of-CPUs or PGOPTIONFILES_MAX_WORKERS at a time.
+      Finish each as soon as its worker has written, whichever that is, and write the usual output with options->format,
+      except that the label goes after "(pgoptionfiles)" e.g. "(pgoptionfiles)(root /images/a)(Connector C version ...)".
+      So output order is the order the workers ended in, not job order -- the label says which job it is.
+  Return: 0 if every job succeeded, else the first (in job order) failure's result code
+*/
+int pgoptionfiles_worker_pool(const struct pgoptionfiles_options *job_options, const char **job_labels, int job_count)
+{
+  long worker_limit= sysconf(_SC_NPROCESSORS_ONLN);
+  if (worker_limit < 1) worker_limit= 1;
+  if (worker_limit > PGOPTIONFILES_MAX_WORKERS) worker_limit= PGOPTIONFILES_MAX_WORKERS;
+  pid_t pids[PGOPTIONFILES_MAX_WORKERS];
+  int read_fds[PGOPTIONFILES_MAX_WORKERS];
+  int jobs[PGOPTIONFILES_MAX_WORKERS];
+  int worker_count= 0;
+  int result= 0, result_job= job_count;
+  int started= 0;
+  fflush(stdout);
+  while ((started < job_count) || (worker_count > 0))
+  {
+    while ((started < job_count) && (worker_count < worker_limit))
+    {
+      pids[worker_count]= pgoptionfiles_worker_start(&job_options[started], &read_fds[worker_count]);
+      jobs[worker_count]= started++;
+      ++worker_count;
+    }
+    /* A worker writes everything at once when it ends, so the first readable pipe is the first finished worker */
+    int w= 0;
+    for (w= 0; w < worker_count; ++w) if (pids[w] < 0) break;
+    if (w == worker_count)
+    {
+      struct pollfd poll_fds[PGOPTIONFILES_MAX_WORKERS];
+      for (int i= 0; i < worker_count; ++i) { poll_fds[i].fd= read_fds[i]; poll_fds[i].events= POLLIN; poll_fds[i].revents= 0; }
+      while (poll(poll_fds, worker_count, -1) < 0)
+        if (errno != EINTR) break;
+      for (w= 0; w < worker_count; ++w) if (poll_fds[w].revents != 0) break;
+      if (w == worker_count) w= 0;
+    }
+    int job= jobs[w];
+    struct pgoptionfiles_list file_names_list;
+    char worker_error_list[4096];
+    char error_list[8192];
+    pgoptionfiles_list_init(&file_names_list);
+    int result_code;
+    if (pids[w] < 0)
+    {
+      strcpy(worker_error_list, "(pgoptionfiles)Error: fork() failed");
+      result_code= -1;
+    }
+    else
+      result_code= pgoptionfiles_worker_finish(pids[w], read_fds[w], &file_names_list, worker_error_list, sizeof(worker_error_list));
+    --worker_count;
+    pids[w]= pids[worker_count];
+    read_fds[w]= read_fds[worker_count];
+    jobs[w]= jobs[worker_count];
+    snprintf(error_list, sizeof(error_list), "(pgoptionfiles)%.4000s%s", job_labels[job], worker_error_list + sizeof("(pgoptionfiles)") - 1);
+    if (job_options[job].is_verify == 1) pgoptionfiles_verify(&file_names_list, job_options[job].root_directory);
+    pgoptionfiles_output(STDOUT_FILENO, &file_names_list, error_list, result_code, job_options[job].format, job_options[job].delimiter);
+    pgoptionfiles_list_free(&file_names_list);
+    if ((result_code != 0) && (job < result_job)) { result= result_code; result_job= job; }
+  }
+  return result;
+}
+
+/*
+  Pass: options with is_diff == 1, library_name = a, library_name_2 = b
+  Do: trace a and b concurrently, print
+        (pgoptionfiles)(diff)
+        a library-a (Connector C version ...) and any errors
+        b library-b (Connector C version ...) and any errors
+        removed file-name            i.e. a has it, b doesn't
+        added file-name              i.e. b has it, a doesn't
+        reordered file-name n m      i.e. both have it, but order relative to the other common files changed,
+                                     n and m are positions (1 = first) in a and b
+  Return: 0 if a and b have the same file names in the same order, 1 if not, or negative if either trace failed
+  "reordered" is everything that's in both but not in a longest common subsequence.
+*/
+int pgoptionfiles_diff(const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_list lists[2];
+  char error_lists[2][4096];
+  struct pgoptionfiles_options worker_options[2];
+  pid_t pids[2];
+  int read_fds[2];
+  int result_codes[2];
+  worker_options[0]= *options;
+  worker_options[0].is_diff= 0;
+  worker_options[1]= worker_options[0];
+  worker_options[1].library_name= options->library_name_2;
+  pgoptionfiles_list_init(&lists[0]);
+  pgoptionfiles_list_init(&lists[1]);
+  for (int i= 0; i < 2; ++i)
+  {
+    pids[i]= pgoptionfiles_worker_start(&worker_options[i], &read_fds[i]);
+    if (pids[i] < 0)
+    {
+      printf("(pgoptionfiles)Error: fork() failed\n");
+      if (i == 1) pgoptionfiles_worker_finish(pids[0], read_fds[0], &lists[0], error_lists[0], sizeof(error_lists[0]));
+      pgoptionfiles_list_free(&lists[0]);
+      return -1;
+    }
+  }
+  for (int i= 0; i < 2; ++i)
+    result_codes[i]= pgoptionfiles_worker_finish(pids[i], read_fds[i], &lists[i], error_lists[i], sizeof(error_lists[i]));
+  printf("(pgoptionfiles)(diff)\n");
+  printf("a %s %s\n", worker_options[0].library_name, error_lists[0] + sizeof("(pgoptionfiles)") - 1);
+  printf("b %s %s\n", worker_options[1].library_name, error_lists[1] + sizeof("(pgoptionfiles)") - 1);
+  int result= 0;
+  if (result_codes[0] != 0) result= result_codes[0];
+  else if (result_codes[1] != 0) result= result_codes[1];
+  else result= pgoptionfiles_diff_print(&lists[0], &lists[1]);
+  pgoptionfiles_list_free(&lists[0]);
+  pgoptionfiles_list_free(&lists[1]);
+  return result;
+}
+
+/* The part of pgoptionfiles_diff() that compares. Return: 0 same, 1 different, -1 out of memory */
+int pgoptionfiles_diff_print(const struct pgoptionfiles_list *a, const struct pgoptionfiles_list *b)
+{
+  unsigned int counts[2]= {a->entry_count, b->entry_count};
+  int is_different= 0;
+  for (unsigned int i= 0; i < counts[0]; ++i)
+    if (pgoptionfiles_list_find(b, PGOPTIONFILES_LIST_NAME(a, i), a->entries[i].name_length) < 0)
+    { printf("removed %s\n", PGOPTIONFILES_LIST_NAME(a, i)); is_different= 1; }
+  for (unsigned int j= 0; j < counts[1]; ++j)
+    if (pgoptionfiles_list_find(a, PGOPTIONFILES_LIST_NAME(b, j), b->entries[j].name_length) < 0)
+    { printf("added %s\n", PGOPTIONFILES_LIST_NAME(b, j)); is_different= 1; }
+
+  /* Longest common subsequence by dynamic programming, lengths[i][j] is for a[i..] and b[j..] */
+  unsigned int width= counts[1] + 1;
+  unsigned int *lengths= calloc((size_t) (counts[0] + 1) * width, sizeof(unsigned int));
+  if (lengths == NULL) { printf("Error: out of memory\n"); return -1; }
+  for (int i= counts[0] - 1; i >= 0; --i)
+    for (int j= counts[1] - 1; j >= 0; --j)
+    {
+      if (strcmp(PGOPTIONFILES_LIST_NAME(a, i), PGOPTIONFILES_LIST_NAME(b, j)) == 0)
+        lengths[i * width + j]= lengths[(i + 1) * width + j + 1] + 1;
+      else if (lengths[(i + 1) * width + j] >= lengths[i * width + j + 1])
+        lengths[i * width + j]= lengths[(i + 1) * width + j];
+      else
+        lengths[i * width + j]= lengths[i * width + j + 1];
+    }
+  /* Walk the table, anything common that's skipped over in a is reordered */
+  unsigned int i= 0, j= 0;
+  while (i < counts[0])
+  {
+    if ((j < counts[1]) && (strcmp(PGOPTIONFILES_LIST_NAME(a, i), PGOPTIONFILES_LIST_NAME(b, j)) == 0)) { ++i; ++j; continue; }
+    if ((j < counts[1]) && (lengths[(i + 1) * width + j] < lengths[i * width + j + 1])) { ++j; continue; }
+    int j_in_b= pgoptionfiles_list_find(b, PGOPTIONFILES_LIST_NAME(a, i), a->entries[i].name_length);
+    if (j_in_b >= 0) { printf("reordered %s %u %d\n", PGOPTIONFILES_LIST_NAME(a, i), i + 1, j_in_b + 1); is_different= 1; }
+    ++i;
+  }
+  free(lengths);
+  return is_different;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* COALESCE ***************
+  --coalesce. When many programs start at once on one host and each asks pgoptionfiles the same question, one
+  of them traces and the others wait for it and take its answer. The question is the key: the library (its real
+  path, and device, inode, size and mtime so a replaced library is a different question), --read, --query,
+  --root, --backend, the effective uid, the current directory, and the environment variables that can change which
+  option files a connector reads or which libraries it loads (pgoptionfiles_coalesce_environment[], in any order).
+  In PGOPTIONFILES_COALESCE_DIRECTORY there are two files per key, pgoptionfiles-UID-KEY.lock and .result.
+  Each caller takes an exclusive flock() of .lock. Whoever has it looks at .result: if it was written since the
+  caller started, i.e. by a trace that was running or finished while the caller waited, that's the answer.
+  Otherwise the caller traces and writes .result (a temporary file + rename(), in the worker format after a header
+  line with the key, result code, and CLOCK_REALTIME when the trace ended) before letting go of the lock. So N
+  simultaneous callers cost one trace, and a caller never gets an answer that is older than itself. A failed trace
+  is shared too, with its result code and error_list, otherwise the waiting callers would each fail the same way
+  in turn while holding the lock. A later caller isn't affected, it started after. The time is in the header rather than
+  taken from the file's mtime because file timestamps may be from a coarser clock than clock_gettime()'s.
+  The files are created 0600 and aren't used unless they're regular files owned by this uid that only it can
+  write, so another user can't plant an answer. If something is wrong with them, the caller traces as if there
+  were no --coalesce. flock() locks go when their process does, so a crashed tracer doesn't block the others.
+  The files are left behind, there's one pair per key.
+*/
+
+/* FNV-1a, 64-bit */
+static uint64_t pgoptionfiles_coalesce_hash(uint64_t hash, const void *data, size_t length)
+{
+  for (size_t i= 0; i < length; ++i) { hash^= ((const unsigned char *) data)[i]; hash*= 1099511628211ULL; }
+  return hash;
+}
+
+static uint64_t pgoptionfiles_coalesce_hash_string(uint64_t hash, const char *s)
+{
+  if (s == NULL) s= "";
+  return pgoptionfiles_coalesce_hash(hash, s, strlen(s) + 1); /* with the '\0', so "ab","c" isn't "a","bc" */
+}
+
+/*
+  Environment variables that are in the key: the ones that connectors read for option files (HOME, MYSQL_HOME,
+  MARIADB_HOME, MYSQL_TEST_LOGIN_FILE ...), plugins (LIBMYSQL_PLUGIN_DIR, MARIADB_PLUGIN_DIR ...), the ones that
+  change which libraries ld.so loads (LD_LIBRARY_PATH, LD_PRELOAD ...), and PGOPTIONFILES_ for the mock connector.
+  A name that ends with '_' is a prefix. Others, e.g. PWD or TERM or a session id, would make every caller a new key.
+*/
+static const char *pgoptionfiles_coalesce_environment[]=
+{
+  "HOME", "MYSQL_", "MARIADB_", "LIBMYSQL_", "LD_", "PGOPTIONFILES_", NULL
+};
+
+/* Return: 1 if environ entry "NAME=value" is one of pgoptionfiles_coalesce_environment[] */
+static int pgoptionfiles_coalesce_is_environment(const char *variable)
+{
+  size_t name_length= strcspn(variable, "=");
+  for (const char **name= pgoptionfiles_coalesce_environment; *name != NULL; ++name)
+  {
+    size_t length= strlen(*name);
+    if ((*name)[length - 1] == '_') { if ((name_length >= length) && (strncmp(variable, *name, length) == 0)) return 1; }
+    else if ((name_length == length) && (strncmp(variable, *name, length) == 0)) return 1;
+  }
+  return 0;
+}
+
+/* Do: make the key, see above. Return: 0 ok, -1 if the library can't be found, then there's no coalescing. */
+static int pgoptionfiles_coalesce_key(const struct pgoptionfiles_options *options, uint64_t *key)
+{
+  char library_path[PATH_MAX];
+  char real_path[PATH_MAX];
+  struct stat library_stat;
+  uint64_t hash= pgoptionfiles_coalesce_hash_string(14695981039346656037ULL, "pgoptionfiles-coalesce1");
+  if (options->library_name == NULL) return -1;
+  snprintf(library_path, sizeof(library_path), "%s%s", (options->root_directory == NULL) ? "" : options->root_directory, options->library_name);
+  if ((realpath(library_path, real_path) == NULL) || (stat(real_path, &library_stat) != 0)) return -1;
+  hash= pgoptionfiles_coalesce_hash_string(hash, real_path);
+  long long library_identity[5]= {(long long) library_stat.st_dev, (long long) library_stat.st_ino, (long long) library_stat.st_size,
+                                  (long long) library_stat.st_mtim.tv_sec, (long long) library_stat.st_mtim.tv_nsec};
+  hash= pgoptionfiles_coalesce_hash(hash, library_identity, sizeof(library_identity));
+  int settings[5]= {options->is_read, options->is_seccomp, options->is_dlmopen, options->query_count, (int) geteuid()};
+  hash= pgoptionfiles_coalesce_hash(hash, settings, sizeof(settings));
+  for (int i= 0; i < options->query_count; ++i)
+  {
+    hash= pgoptionfiles_coalesce_hash_string(hash, options->queries[i].group);
+    hash= pgoptionfiles_coalesce_hash_string(hash, options->queries[i].file);
+  }
+  hash= pgoptionfiles_coalesce_hash_string(hash, options->root_directory);
+  if (getcwd(library_path, sizeof(library_path)) == NULL) return -1;
+  hash= pgoptionfiles_coalesce_hash_string(hash, library_path);
+  extern char **environ;
+  uint64_t environment_hash= 0; /* a sum, so the order of environ doesn't matter */
+  for (char **variable= environ; *variable != NULL; ++variable)
+    if (pgoptionfiles_coalesce_is_environment(*variable))
+      environment_hash+= pgoptionfiles_coalesce_hash_string(14695981039346656037ULL, *variable);
+  *key= pgoptionfiles_coalesce_hash(hash, &environment_hash, sizeof(environment_hash));
+  return 0;
+}
+
+/* Do: open(), and check that it's a regular file that only this uid can write. Return: fd, or -1. */
+static int pgoptionfiles_coalesce_open(const char *path, int flags, struct stat *file_stat)
+{
+  int fd= open(path, flags | O_NOFOLLOW | O_CLOEXEC, 0600);
+  if (fd < 0) return -1;
+  if ((fstat(fd, file_stat) != 0) || !S_ISREG(file_stat->st_mode) || (file_stat->st_uid != geteuid()) || ((file_stat->st_mode & 022) != 0))
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*
+  Pass: result file fd and its stat, the key, the caller's start time, pgoptionfiles_run()'s list and error_list,
+        where to put the trace's result code
+  Do: if the result file is for this key and its trace ended since start_time, fill the list and error_list from it
+  Return: 0 ok, -1 if it can't be used
+*/
+static int pgoptionfiles_coalesce_read(int fd, const struct stat *file_stat, uint64_t key, const struct timespec *start_time,
+                                       struct pgoptionfiles_list *file_names_list, char *error_list, int *result_code)
+{
+  if ((file_stat->st_size <= 0) || (file_stat->st_size > 64 + 4096 + 2 * (off_t) PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE + (off_t) PATH_MAX * 64))
+    return -1;
+  char *buffer= malloc(file_stat->st_size + 1);
+  if (buffer == NULL) return -1;
+  ssize_t length= pread(fd, buffer, file_stat->st_size, 0);
+  int read_result= -1;
+  unsigned long long file_key;
+  long long end_seconds;
+  long end_nanoseconds;
+  int file_result_code, header_length= 0;
+  if (length == file_stat->st_size)
+  {
+    buffer[length]= '\0'; /* the header is text, this stops sscanf() at the end if it's not */
+    if ((sscanf(buffer, "pgoptionfiles-coalesce1 %llx %d %lld.%ld\n%n", &file_key, &file_result_code, &end_seconds, &end_nanoseconds, &header_length) == 4)
+     && (header_length > 0) && (file_key == key)
+     && ((end_seconds > (long long) start_time->tv_sec) || ((end_seconds == (long long) start_time->tv_sec) && (end_nanoseconds >= start_time->tv_nsec)))
+     && (pgoptionfiles_worker_parse(buffer + header_length, length - header_length, file_names_list, error_list, 4096) == 0))
+    {
+      *result_code= file_result_code; /* 4096 is the size of every caller's error_list */
+      read_result= 0;
+    }
+  }
+  free(buffer);
+  return read_result;
+}
+
+/* Do: write a result file for the others, temporary file + rename() so they see all of it or none */
+static void pgoptionfiles_coalesce_write(const char *result_path, uint64_t key, int result_code,
+                                         const struct pgoptionfiles_list *file_names_list, const char *error_list)
+{
+  char temporary_path[PATH_MAX + 32];
+  struct stat file_stat;
+  struct timespec end_time;
+  clock_gettime(CLOCK_REALTIME, &end_time);
+  snprintf(temporary_path, sizeof(temporary_path), "%s.%d", result_path, (int) getpid());
+  unlink(temporary_path); /* left by an earlier process with this pid that crashed, no one else writes this name */
+  int fd= pgoptionfiles_coalesce_open(temporary_path, O_WRONLY | O_CREAT | O_EXCL, &file_stat);
+  if (fd < 0) return;
+  FILE *fp= fdopen(fd, "wb");
+  if (fp == NULL) { close(fd); unlink(temporary_path); return; }
+  fprintf(fp, "pgoptionfiles-coalesce1 %016llx %d %lld.%09ld\n", (unsigned long long) key, result_code, (long long) end_time.tv_sec, end_time.tv_nsec);
+  pgoptionfiles_worker_write(fp, file_names_list, error_list);
+  int is_error= (ferror(fp) != 0);
+  if ((fclose(fp) != 0) || is_error || (rename(temporary_path, result_path) != 0)) unlink(temporary_path);
+}
+
+/*
+  Pass: same as pgoptionfiles_run(), with options->is_coalesce == 1
+  Do: take the answer from a concurrent identical call, or trace and leave the answer for the others
+  Return: same as pgoptionfiles_run()
+*/
+int pgoptionfiles_coalesce(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_options run_options= *options;
+  run_options.is_coalesce= 0;
+  struct timespec start_time;
+  clock_gettime(CLOCK_REALTIME, &start_time);
+  uint64_t key;
+  if (pgoptionfiles_coalesce_key(options, &key) != 0)
+    return pgoptionfiles_run(file_names_list, error_list, &run_options);
+  char lock_path[PATH_MAX];
+  char result_path[PATH_MAX];
+  struct stat file_stat;
+  snprintf(lock_path, sizeof(lock_path), "%s/pgoptionfiles-%d-%016llx.lock", PGOPTIONFILES_COALESCE_DIRECTORY, (int) geteuid(), (unsigned long long) key);
+  snprintf(result_path, sizeof(result_path), "%s/pgoptionfiles-%d-%016llx.result", PGOPTIONFILES_COALESCE_DIRECTORY, (int) geteuid(), (unsigned long long) key);
+  int lock_fd= pgoptionfiles_coalesce_open(lock_path, O_RDWR | O_CREAT, &file_stat);
+  if (lock_fd < 0)
+    return pgoptionfiles_run(file_names_list, error_list, &run_options);
+  int flock_result;
+  while (((flock_result= flock(lock_fd, LOCK_EX)) != 0) && (errno == EINTR)) {;}
+  if (flock_result != 0)
+  {
+    close(lock_fd);
+    return pgoptionfiles_run(file_names_list, error_list, &run_options);
+  }
+  int result_code= 0;
+  int read_result= -1;
+  int result_fd= pgoptionfiles_coalesce_open(result_path, O_RDONLY, &file_stat);
+  if (result_fd >= 0)
+  {
+    read_result= pgoptionfiles_coalesce_read(result_fd, &file_stat, key, &start_time, file_names_list, error_list, &result_code);
+    close(result_fd);
+  }
+  if (read_result != 0) /* no usable answer, so this is the caller that traces. The list and error_list are untouched. */
+  {
+    result_code= pgoptionfiles_run(file_names_list, error_list, &run_options);
+    pgoptionfiles_coalesce_write(result_path, key, result_code, file_names_list, error_list);
+  }
+  close(lock_fd); /* and so flock() is over */
+  return result_code;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* SCAN ***************
+  --scan DIRS. A walker is a child process that walks one directory and writes a struct pgoptionfiles_scan_candidate
+  followed by the path for each Connector C library it finds. The parent reads the walkers' pipes one after another
+  (they keep walking meanwhile, the pipe only fills if there are hundreds of libraries), sorts, removes duplicates,
+  then traces with a pool of workers. Identification reads the ELF section headers, .dynsym, .dynstr, and notes.
+*/
+
+struct pgoptionfiles_scan_candidate
+{
+  uint64_t device;
+  uint64_t inode;
+  uint32_t build_id_length;       /* 0 if no NT_GNU_BUILD_ID */
+  uint32_t path_length;
+  int32_t is_symbolic_link;
+  unsigned char build_id[64];
+  char *path;                     /* in the parent, malloc'd. In the pipe, path_length bytes follow the struct */
+  int duplicate_of;               /* in the parent, -1 or the candidate number that will be traced instead */
+};
+
+/* pread() exactly length bytes into a malloc'd buffer. Return: buffer or NULL */
+static void *pgoptionfiles_scan_read(int fd, size_t length, off_t offset)
+{
+  if ((length == 0) || (length > 64 * 1024 * 1024)) return NULL;
+  void *buffer= malloc(length);
+  if (buffer == NULL) return NULL;
+  if (pread(fd, buffer, length, offset) != (ssize_t) length) { free(buffer); return NULL; }
+  return buffer;
+}
+
+/*
+  Pass: path of a regular file, candidate to fill in build_id
+  Return: 1 if it's an ELF shared object for this word size with mysql_init and mysql_real_connect defined, else 0
+*/
+static int pgoptionfiles_scan_elf(const char *path, struct pgoptionfiles_scan_candidate *candidate)
+{
+  int result= 0;
+  int fd= open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) return 0;
+  ElfW(Ehdr) ehdr;
+  ElfW(Shdr) *shdrs= NULL;
+  ElfW(Sym) *symbols= NULL;
+  char *strings= NULL;
+  if (pread(fd, &ehdr, sizeof(ehdr), 0) != (ssize_t) sizeof(ehdr)) goto end;
+  if ((memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0) || (ehdr.e_ident[EI_CLASS] != ((__SIZEOF_POINTER__ == 8) ? ELFCLASS64 : ELFCLASS32))) goto end;
+  if ((ehdr.e_type != ET_DYN) || (ehdr.e_shentsize != sizeof(ElfW(Shdr))) || (ehdr.e_shnum == 0)) goto end;
+  shdrs= pgoptionfiles_scan_read(fd, ehdr.e_shnum * sizeof(ElfW(Shdr)), ehdr.e_shoff);
+  if (shdrs == NULL) goto end;
+  candidate->build_id_length= 0;
+  for (int i= 0; i < ehdr.e_shnum; ++i)
+  {
+    if ((shdrs[i].sh_type == SHT_NOTE) && (candidate->build_id_length == 0) && (shdrs[i].sh_size <= 4096))
+    {
+      char *notes= pgoptionfiles_scan_read(fd, shdrs[i].sh_size, shdrs[i].sh_offset);
+      if (notes == NULL) continue;
+      for (size_t offset= 0; offset + sizeof(ElfW(Nhdr)) <= shdrs[i].sh_size; )
+      {
+        ElfW(Nhdr) nhdr;
+        memcpy(&nhdr, notes + offset, sizeof(nhdr));
+        size_t name_offset= offset + sizeof(nhdr);
+        size_t desc_offset= name_offset + ((nhdr.n_namesz + 3) & ~3u);
+        size_t next_offset= desc_offset + ((nhdr.n_descsz + 3) & ~3u);
+        if (next_offset > shdrs[i].sh_size) break;
+        if ((nhdr.n_type == NT_GNU_BUILD_ID) && (nhdr.n_namesz == 4) && (memcmp(notes + name_offset, "GNU", 4) == 0)
+         && (nhdr.n_descsz > 0) && (nhdr.n_descsz <= sizeof(candidate->build_id)))
+        {
+          memcpy(candidate->build_id, notes + desc_offset, nhdr.n_descsz);
+          candidate->build_id_length= nhdr.n_descsz;
+          break;
+        }
+        offset= next_offset;
+      }
+      free(notes);
+    }
+    if ((shdrs[i].sh_type == SHT_DYNSYM) && (symbols == NULL) && (shdrs[i].sh_link < ehdr.e_shnum)
+     && (shdrs[i].sh_entsize == sizeof(ElfW(Sym))))
+    {
+      const ElfW(Shdr) *strings_shdr= &shdrs[shdrs[i].sh_link];
+      symbols= pgoptionfiles_scan_read(fd, shdrs[i].sh_size, shdrs[i].sh_offset);
+      strings= pgoptionfiles_scan_read(fd, strings_shdr->sh_size + 1, strings_shdr->sh_offset);
+      if ((symbols == NULL) || (strings == NULL)) goto end;
+      strings[strings_shdr->sh_size]= '\0'; /* we read one byte too many, it's the first byte after, or pread() failed */
+      int is_init_seen= 0, is_real_connect_seen= 0;
+      for (size_t j= 0; j < shdrs[i].sh_size / sizeof(ElfW(Sym)); ++j)
+      {
+        if ((symbols[j].st_shndx == SHN_UNDEF) || (symbols[j].st_name >= strings_shdr->sh_size)) continue;
+        if (strcmp(strings + symbols[j].st_name, "mysql_init") == 0) is_init_seen= 1;
+        else if (strcmp(strings + symbols[j].st_name, "mysql_real_connect") == 0) is_real_connect_seen= 1;
+      }
+      if (is_init_seen && is_real_connect_seen) result= 1;
+    }
+  }
+end:
+  free(strings);
+  free(symbols);
+  free(shdrs);
+  close(fd);
+  return result;
+}
+
+/* nftw() has no user pointer, this is the walker's pipe, and each walker is a separate process so that's fine */
+static int pgoptionfiles_scan_write_fd= -1;
+
+static int pgoptionfiles_scan_walk_callback(const char *path, const struct stat *path_stat, int type, struct FTW *ftw)
+{
+  (void) ftw;
+  if ((type != FTW_F) && (type != FTW_SL)) return 0;
+  const char *base_name= strrchr(path, '/');
+  base_name= (base_name == NULL) ? path : base_name + 1;
+  size_t length= strlen(base_name);
+  if (((length < 4) || (strcmp(base_name + length - 3, ".so") != 0)) && (strstr(base_name, ".so.") == NULL)) return 0;
+  struct pgoptionfiles_scan_candidate candidate;
+  memset(&candidate, 0, sizeof(candidate));
+  struct stat target_stat= *path_stat;
+  if (type == FTW_SL)
+  {
+    if (stat(path, &target_stat) != 0) return 0; /* dangling */
+    candidate.is_symbolic_link= 1;
+  }
+  if (!S_ISREG(target_stat.st_mode)) return 0;
+  if (pgoptionfiles_scan_elf(path, &candidate) == 0) return 0;
+  candidate.device= target_stat.st_dev;
+  candidate.inode= target_stat.st_ino;
+  candidate.path_length= strlen(path);
+  struct iovec iov[2]= {{&candidate, offsetof(struct pgoptionfiles_scan_candidate, path)}, {(void *) path, candidate.path_length}};
+  if (pgoptionfiles_output_writev(pgoptionfiles_scan_write_fd, iov, 2) != 0) return 1; /* parent is gone, stop */
+  return 0;
+}
+
+static int pgoptionfiles_scan_compare(const void *a, const void *b)
+{
+  return strcmp(((const struct pgoptionfiles_scan_candidate *) a)->path, ((const struct pgoptionfiles_scan_candidate *) b)->path);
+}
+
+/*
+  Pass: options with scan_directories
+  Do: walk, identify, deduplicate, trace, print, as described in the header comment for --scan
+  Return: 0 if every trace succeeded, else the first failure's result code, or -1 if nothing could start
+*/
+int pgoptionfiles_scan(const struct pgoptionfiles_options *options)
+{
+  char directories[PATH_MAX * 4];
+  snprintf(directories, sizeof(directories), "%s", options->scan_directories);
+  pid_t walker_pids[PGOPTIONFILES_MAX_WORKERS * 4];
+  int walker_fds[PGOPTIONFILES_MAX_WORKERS * 4];
+  int walker_count= 0;
+  fflush(stdout);
+  for (char *directory= strtok(directories, ":"); directory != NULL; directory= strtok(NULL, ":"))
+  {
+    int pipe_fds[2];
+    if (walker_count == PGOPTIONFILES_MAX_WORKERS * 4) break;
+    if (pipe(pipe_fds) != 0) break;
+    pid_t pid= fork();
+    if (pid < 0) { close(pipe_fds[0]); close(pipe_fds[1]); break; }
+    if (pid == 0)
+    {
+      close(pipe_fds[0]);
+      for (int i= 0; i < walker_count; ++i) close(walker_fds[i]);
+      pgoptionfiles_scan_write_fd= pipe_fds[1];
+      nftw(directory, pgoptionfiles_scan_walk_callback, 64, FTW_PHYS);
+      _exit(0);
+    }
+    close(pipe_fds[1]);
+    walker_pids[walker_count]= pid;
+    walker_fds[walker_count]= pipe_fds[0];
+    ++walker_count;
+  }
+  /* Collect */
+  struct pgoptionfiles_scan_candidate *candidates= NULL;
+  int candidate_count= 0, candidates_allocated= 0;
+  for (int w= 0; w < walker_count; ++w)
+  {
+    FILE *fp= fdopen(walker_fds[w], "rb");
+    if (fp == NULL) { close(walker_fds[w]); continue; }
+    for (;;)
+    {
+      struct pgoptionfiles_scan_candidate candidate;
+      if (fread(&candidate, offsetof(struct pgoptionfiles_scan_candidate, path), 1, fp) != 1) break;
+      if (candidate.path_length >= PATH_MAX) break;
+      candidate.path= malloc(candidate.path_length + 1);
+      if (candidate.path == NULL) break;
+      if (fread(candidate.path, 1, candidate.path_length, fp) != candidate.path_length) { free(candidate.path); break; }
+      candidate.path[candidate.path_length]= '\0';
+      candidate.duplicate_of= -1;
+      if (candidate_count == candidates_allocated)
+      {
+        int new_count= (candidates_allocated == 0) ? 16 : candidates_allocated * 2;
+        struct pgoptionfiles_scan_candidate *new_candidates= realloc(candidates, new_count * sizeof(candidate));
+        if (new_candidates == NULL) { free(candidate.path); break; }
+        candidates= new_candidates;
+        candidates_allocated= new_count;
+      }
+      candidates[candidate_count++]= candidate;
+    }
+    fclose(fp);
+    while ((waitpid(walker_pids[w], NULL, 0) < 0) && (errno == EINTR)) {;}
+  }
+  /* Deduplicate. Sorted by path so the output is the same every time. The one to trace is the first that isn't a symbolic link. */
+  if (candidate_count > 0) qsort(candidates, candidate_count, sizeof(candidates[0]), pgoptionfiles_scan_compare);
+  int duplicate_count= 0;
+  for (int i= 0; i < candidate_count; ++i)
+  {
+    for (int j= 0; j < i; ++j)
+    {
+      if (candidates[j].duplicate_of >= 0) continue;
+      if (((candidates[i].device == candidates[j].device) && (candidates[i].inode == candidates[j].inode))
+       || ((candidates[i].build_id_length > 0) && (candidates[i].build_id_length == candidates[j].build_id_length)
+        && (memcmp(candidates[i].build_id, candidates[j].build_id, candidates[i].build_id_length) == 0)))
+      {
+        if ((candidates[j].is_symbolic_link == 1) && (candidates[i].is_symbolic_link == 0))
+        {
+          /* i becomes the one to trace, j and everything that was a duplicate of j become duplicates of i */
+          for (int k= 0; k < i; ++k) if (candidates[k].duplicate_of == j) candidates[k].duplicate_of= i;
+          candidates[j].duplicate_of= i;
+        }
+        else candidates[i].duplicate_of= j;
+        ++duplicate_count;
+        break;
+      }
+    }
+  }
+  /* Trace, at most worker_limit at a time, each report is written when its worker ends and starts with its label */
+  int is_json= ((options->format != NULL) && (strcmp(options->format, "json") == 0));
+  char host_name[256]= "";
+  gethostname(host_name, sizeof(host_name) - 1);
+  if (is_json)
+  {
+    printf("{\"scan\":\"");
+    pgoptionfiles_metrics_print_escaped(stdout, host_name, 1);
+    printf("\",\"libraries\":%d,\"duplicates\":%d}\n", candidate_count - duplicate_count, duplicate_count);
+  }
+  else
+    printf("(pgoptionfiles)(scan %s)(libraries %d)(duplicates %d)%c", host_name, candidate_count - duplicate_count, duplicate_count,
+           ((options->format != NULL) && (strcmp(options->format, "nul") == 0)) ? '\0' : '\n');
+  fflush(stdout);
+  /* Each job's label is (library path)(also path)... */
+  struct pgoptionfiles_options *job_options= malloc((candidate_count + 1) * sizeof(struct pgoptionfiles_options));
+  char **job_labels= calloc(candidate_count + 1, sizeof(char *));
+  int job_count= 0;
+  int result= (walker_count == 0) ? -1 : 0;
+  if ((job_options == NULL) || (job_labels == NULL)) { printf("(pgoptionfiles)Error: out of memory\n"); result= -1; }
+  else for (int i= 0; i < candidate_count; ++i)
+  {
+    if (candidates[i].duplicate_of >= 0) continue;
+    size_t label_size= PATH_MAX + 16;
+    for (int j= 0; j < candidate_count; ++j) if (candidates[j].duplicate_of == i) label_size+= candidates[j].path_length + 8;
+    char *label= malloc(label_size);
+    if (label == NULL) continue;
+    size_t label_length= snprintf(label, label_size, "(library %s)", candidates[i].path);
+    for (int j= 0; j < candidate_count; ++j)
+      if (candidates[j].duplicate_of == i) label_length+= snprintf(label + label_length, label_size - label_length, "(also %s)", candidates[j].path);
+    job_options[job_count]= *options;
+    job_options[job_count].scan_directories= NULL;
+    job_options[job_count].library_name= candidates[i].path;
+    job_labels[job_count++]= label;
+  }
+  if (job_count > 0)
+  {
+    int pool_result= pgoptionfiles_worker_pool(job_options, (const char **) job_labels, job_count);
+    if (result == 0) result= pool_result;
+  }
+  for (int i= 0; i < job_count; ++i) free(job_labels[i]);
+  free(job_labels);
+  free(job_options);
+  for (int i= 0; i < candidate_count; ++i) free(candidates[i].path);
+  free(candidates);
+  return result;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) || (PGOPTIONFILES_TRACEE_PROGRAM == 1)
+/*
+  ******************* ROOT ***************
+  --root. pgoptionfiles_root_enter() is called by the tracee, after it's traced, so errors go to the tracer the usual way.
+  It's in pgoptionfiles_tracee too.
+  The tracee's own file accesses here (e.g. /etc/passwd) happen before "(Connector C version ...)" so they're ignored.
+*/
+
+static int pgoptionfiles_root_write_file(const char *file_name, const char *contents)
+{
+  int fd= open(file_name, O_WRONLY | O_CLOEXEC);
+  if (fd < 0) return -1;
+  ssize_t write_result= write(fd, contents, strlen(contents));
+  close(fd);
+  return (write_result == (ssize_t) strlen(contents)) ? 0 : -1;
+}
+
+/* Return: NULL ok, or an "Error: ..." message */
+const char *pgoptionfiles_root_enter(const char *root_directory)
+{
+  char map[64];
+  uid_t uid= getuid();
+  gid_t gid= getgid();
+  if (unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0)
+    return "Error: unshare() failed -- are unprivileged user namespaces disabled?";
+  /* setgroups must be denied before an unprivileged process can write gid_map */
+  if (pgoptionfiles_root_write_file("/proc/self/setgroups", "deny") != 0) return "Error: cannot write /proc/self/setgroups";
+  sprintf(map, "0 %u 1", (unsigned int) uid);
+  if (pgoptionfiles_root_write_file("/proc/self/uid_map", map) != 0) return "Error: cannot write /proc/self/uid_map";
+  sprintf(map, "0 %u 1", (unsigned int) gid);
+  if (pgoptionfiles_root_write_file("/proc/self/gid_map", map) != 0) return "Error: cannot write /proc/self/gid_map";
+  /* Nothing is mounted, but make sure nothing done in here could propagate back */
+  if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0) return "Error: mount() failed making / private";
+  if ((chroot(root_directory) != 0) || (chdir("/") != 0)) return "Error: chroot() failed -- does --root DIR exist?";
+  const char *home= "/root";
+  FILE *passwd_file= fopen("/etc/passwd", "r");
+  if (passwd_file != NULL)
+  {
+    struct passwd *pw;
+    while ((pw= fgetpwent(passwd_file)) != NULL)
+      if (pw->pw_uid == 0) { home= strdup(pw->pw_dir); break; }
+    fclose(passwd_file);
+  }
+  setenv("HOME", (home != NULL) ? home : "/root", 1);
+  setenv("USER", "root", 1);
+  return NULL;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+
+/*
+  Pass: options with root_directories = DIR:DIR...
+  Do: one worker job per DIR, see pgoptionfiles_worker_pool()
+  Return: pgoptionfiles_worker_pool() result
+*/
+int pgoptionfiles_roots(const struct pgoptionfiles_options *options)
+{
+  char *directories= strdup(options->root_directories);
+  if (directories == NULL) { printf("(pgoptionfiles)Error: out of memory\n"); return -1; }
+  int job_count= 0;
+  for (const char *p= directories; *p != '\0'; ++p) if (*p == ':') ++job_count;
+  ++job_count;
+  struct pgoptionfiles_options *job_options= malloc(job_count * sizeof(struct pgoptionfiles_options));
+  char **job_labels= calloc(job_count, sizeof(char *));
+  int result= -1;
+  if ((job_options != NULL) && (job_labels != NULL))
+  {
+    job_count= 0;
+    for (char *directory= strtok(directories, ":"); directory != NULL; directory= strtok(NULL, ":"))
+    {
+      job_labels[job_count]= malloc(strlen(directory) + sizeof("(root )"));
+      if (job_labels[job_count] == NULL) break;
+      sprintf(job_labels[job_count], "(root %s)", directory);
+      job_options[job_count]= *options;
+      job_options[job_count].root_directory= directory;
+      ++job_count;
+    }
+    result= pgoptionfiles_worker_pool(job_options, (const char **) job_labels, job_count);
+    for (int i= 0; i < job_count; ++i) free(job_labels[i]);
+  }
+  else printf("(pgoptionfiles)Error: out of memory\n");
+  free(job_labels);
+  free(job_options);
+  free(directories);
+  return result;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* ASYNC ***************
+  For a program with an event loop, e.g. ocelotgui with Qt, that shouldn't block while the trace happens.
+  pgoptionfiles_async_start() posix_spawn()s PGOPTIONFILES_PROGRAM_NAME from the caller's own directory (as
+  pgoptionfiles_tracee_spawn() does for pgoptionfiles_tracee) with the caller's options as arguments and --format stream,
+  and stdout a pipe. Not fork(), because the caller is typically multithreaded, and a fork() child of a multithreaded
+  process may only call async-signal-safe functions, which pgoptionfiles_run() doesn't keep to.
+  --format stream is pgoptionfiles_stream(): the list has stream_fd set, so each file name goes down the pipe as soon as
+  its syscall is over (pgoptionfiles_list_stream()), followed at the end by "D" result-code " " error-list '\0'.
+  The caller gets the pipe's read end, non-blocking,
+  and when it's readable (poll(), QSocketNotifier, GIOChannel ...) calls pgoptionfiles_async_pump(), which reads
+  what's there and calls file_callback for each file and done_callback at the end. Nothing blocks in the caller.
+    int fd= pgoptionfiles_async_start(&async, &options, on_file, on_done, this);
+    QSocketNotifier *notifier= new QSocketNotifier(fd, QSocketNotifier::Read);
+    connect(notifier, &QSocketNotifier::activated, [&]() { if (pgoptionfiles_async_pump(&async) == 0) delete notifier; });
+  The callbacks are called from pgoptionfiles_async_pump(), i.e. in the caller's thread. pgoptionfiles_async_cancel()
+  kills the worker (and so its tracee, which has PTRACE_O_EXITKILL). Either way the pipe is closed at the end.
+  Options that are one pgoptionfiles_run() are passed on. --verify, --watch etc. and metrics_result aren't, the worker's
+  --metrics and --perf-counters output goes to the caller's stderr.
+*/
+
+/*
+  Pass: options, fd to write to
+  Do: pgoptionfiles_run() with the list streamed to fd, then the "D" record
+  Return: result code
+*/
+int pgoptionfiles_stream(const struct pgoptionfiles_options *options, int fd)
+{
+  struct pgoptionfiles_list file_names_list;
+  char error_list[4096]= "(pgoptionfiles)";
+  char header[32];
+  struct iovec iov[2];
+  pgoptionfiles_list_init(&file_names_list);
+  file_names_list.stream_fd= fd;
+  int result_code= pgoptionfiles_run(&file_names_list, error_list, options);
+  pgoptionfiles_list_stream(&file_names_list, NULL); /* in case it ended without pgoptionfiles_tracer_finish() */
+  iov[0].iov_base= header;
+  iov[0].iov_len= sprintf(header, "D%d ", result_code);
+  iov[1].iov_base= error_list;
+  iov[1].iov_len= strlen(error_list) + 1;
+  pgoptionfiles_output_writev(fd, iov, 2);
+  pgoptionfiles_list_free(&file_names_list);
+  return result_code;
+}
+
+/*
+  Pass: async (caller's, uninitialized), options, callbacks (file_callback may be NULL), user_data passed to callbacks
+  Do: start the worker
+  Return: fd to poll for POLLIN, or -1 if PGOPTIONFILES_PROGRAM_NAME isn't in the caller's directory or pipe() or posix_spawn() failed
+*/
+int pgoptionfiles_async_start(struct pgoptionfiles_async *async, const struct pgoptionfiles_options *options,
+                              pgoptionfiles_async_file_callback file_callback, pgoptionfiles_async_done_callback done_callback,
+                              void *user_data)
+{
+  int pipe_fds[2];
+  char program_name[PATH_MAX];
+  char pid_string[16];
+  char query_strings[PGOPTIONFILES_MAX_QUERIES][PGOPTIONFILES_QUERY_LABEL_SIZE];
+  char *argv[32 + PGOPTIONFILES_MAX_QUERIES * 2];
+  memset(async, 0, sizeof(*async));
+  async->fd= -1;
+  async->file_callback= file_callback;
+  async->done_callback= done_callback;
+  async->user_data= user_data;
+  ssize_t length= readlink("/proc/self/exe", program_name, sizeof(program_name) - sizeof(PGOPTIONFILES_PROGRAM_NAME) - 1);
+  if (length <= 0) return -1;
+  program_name[length]= '\0';
+  char *slash= strrchr(program_name, '/');
+  if (slash == NULL) return -1;
+  strcpy(slash + 1, PGOPTIONFILES_PROGRAM_NAME);
+  if (access(program_name, X_OK) != 0) return -1;
+  int argc= 0;
+  argv[argc++]= program_name;
+  if (options->library_name != NULL) argv[argc++]= (char *) options->library_name;
+  if (options->replay_file_name != NULL) { argv[argc++]= (char *) "--replay"; argv[argc++]= (char *) options->replay_file_name; }
+  if (options->attach_pid != 0)
+  {
+    sprintf(pid_string, "%d", (int) options->attach_pid);
+    argv[argc++]= (char *) "--pid";
+    argv[argc++]= pid_string;
+  }
+  if (options->record_file_name != NULL) { argv[argc++]= (char *) "--record"; argv[argc++]= (char *) options->record_file_name; }
+  if (options->is_seccomp == 1) { argv[argc++]= (char *) "--backend"; argv[argc++]= (char *) "seccomp"; }
+  if (options->is_dlmopen == 1) { argv[argc++]= (char *) "--backend"; argv[argc++]= (char *) "dlmopen"; }
+  for (int i= 0; i < options->query_count; ++i)
+  {
+    if (options->queries[i].file == NULL) snprintf(query_strings[i], sizeof(query_strings[i]), "%s", options->queries[i].group);
+    else snprintf(query_strings[i], sizeof(query_strings[i]), "%s,%s", options->queries[i].group, options->queries[i].file);
+    argv[argc++]= (char *) "--query";
+    argv[argc++]= query_strings[i];
+  }
+  if (options->root_directory != NULL) { argv[argc++]= (char *) "--root"; argv[argc++]= (char *) options->root_directory; }
+  if (options->is_profile == 1) argv[argc++]= (char *) "--profile";
+  argv[argc++]= (char *) ((options->is_read == 1) ? "--read" : "--no-read");
+  argv[argc++]= (char *) ((options->is_timeout == 1) ? "--timeout" : "--no-timeout");
+  if (options->is_perf_counters == 1) argv[argc++]= (char *) "--perf-counters";
+  if (options->is_coalesce == 1) argv[argc++]= (char *) "--coalesce";
+  if (options->metrics_format != NULL) { argv[argc++]= (char *) "--metrics"; argv[argc++]= (char *) options->metrics_format; }
+  if (options->placement != NULL) { argv[argc++]= (char *) "--placement"; argv[argc++]= (char *) options->placement; }
+  if (options->sched != NULL) { argv[argc++]= (char *) "--sched"; argv[argc++]= (char *) options->sched; }
+  argv[argc++]= (char *) "--format";
+  argv[argc++]= (char *) "stream";
+  argv[argc]= NULL;
+  if (pipe2(pipe_fds, O_CLOEXEC) != 0) return -1;
+  /* dup2() clears O_CLOEXEC on the worker's stdout, both pipe_fds are closed by the exec */
+  posix_spawn_file_actions_t file_actions;
+  if (posix_spawn_file_actions_init(&file_actions) != 0) { close(pipe_fds[0]); close(pipe_fds[1]); return -1; }
+  posix_spawn_file_actions_adddup2(&file_actions, pipe_fds[1], STDOUT_FILENO);
+  extern char **environ;
+  int spawn_result= posix_spawn(&async->pid, program_name, &file_actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&file_actions);
+  close(pipe_fds[1]);
+  if (spawn_result != 0) { close(pipe_fds[0]); return -1; }
+  fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+  async->fd= pipe_fds[0];
+  return async->fd;
+}
+
+/* Do: the end, once: done_callback, close, reap */
+static void pgoptionfiles_async_end(struct pgoptionfiles_async *async, int result_code, const char *error_list)
+{
+  close(async->fd);
+  async->fd= -1;
+  while ((waitpid(async->pid, NULL, 0) < 0) && (errno == EINTR)) {;}
+  free(async->buffer);
+  async->buffer= NULL;
+  if (async->done_callback != NULL) async->done_callback(async->user_data, result_code, error_list);
+}
+
+/*
+  Pass: async after pgoptionfiles_async_start(), when its fd is readable (calling it when it isn't is harmless)
+  Do: read what's there, call file_callback for each complete file record, done_callback if it's the end
+  Return: 1 = more to come, keep polling. 0 = finished, done_callback has been called and fd is closed.
+*/
+int pgoptionfiles_async_pump(struct pgoptionfiles_async *async)
+{
+  if (async->fd < 0) return 0;
+  for (;;)
+  {
+    if (async->buffer_size - async->buffer_used < PATH_MAX)
+    {
+      size_t new_size= (async->buffer_size == 0) ? PATH_MAX * 2 : async->buffer_size * 2;
+      char *new_buffer= realloc(async->buffer, new_size);
+      if (new_buffer == NULL)
+      {
+        pgoptionfiles_async_cancel(async);
+        if (async->done_callback != NULL) async->done_callback(async->user_data, -1, "(pgoptionfiles)Error: out of memory");
+        return 0;
+      }
+      async->buffer= new_buffer;
+      async->buffer_size= new_size;
+    }
+    ssize_t read_result= read(async->fd, async->buffer + async->buffer_used, async->buffer_size - async->buffer_used);
+    if (read_result < 0)
+    {
+      if (errno == EINTR) continue;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) return 1;
+      read_result= 0; /* treat as end */
+    }
+    if (read_result == 0)
+    {
+      pgoptionfiles_async_end(async, -1, "(pgoptionfiles)Error: worker ended without a result");
+      return 0;
+    }
+    async->buffer_used+= read_result;
+    /* Each record ends with '\0'. A partial one stays in the buffer till the next read. */
+    size_t start= 0;
+    for (;;)
+    {
+      char *end= memchr(async->buffer + start, '\0', async->buffer_used - start);
+      if (end == NULL) break;
+      char *record= async->buffer + start;
+      start= end - async->buffer + 1;
+      if (record[0] == 'Q') snprintf(async->query_label, sizeof(async->query_label), "%s", record + 1);
+      else if (record[0] == 'F')
+      {
+        struct pgoptionfiles_entry entry;
+        int name_offset= 0;
+        memset(&entry, 0, sizeof(entry));
+        if ((sscanf(record + 1, "%d %ld %n", &entry.is_denied, &entry.syscall_result, &name_offset) >= 2)
+         && (name_offset > 0) && (async->file_callback != NULL))
+          async->file_callback(async->user_data, record + 1 + name_offset, pgoptionfiles_entry_status(&entry),
+                               (async->query_label[0] == '\0') ? NULL : async->query_label);
+      }
+      else if (record[0] == 'D')
+      {
+        int result_code= -1, error_offset= 0;
+        sscanf(record + 1, "%d %n", &result_code, &error_offset);
+        /* pgoptionfiles_async_end() frees the buffer, so copy */
+        char error_list[4096];
+        snprintf(error_list, sizeof(error_list), "%s", record + 1 + error_offset);
+        pgoptionfiles_async_end(async, result_code, error_list);
+        return 0;
+      }
+    }
+    memmove(async->buffer, async->buffer + start, async->buffer_used - start);
+    async->buffer_used-= start;
+  }
+}
+
+/* Do: stop the worker if it's still going, no more callbacks */
+void pgoptionfiles_async_cancel(struct pgoptionfiles_async *async)
+{
+  if (async->fd < 0) return;
+  kill(async->pid, SIGKILL);
+  close(async->fd);
+  async->fd= -1;
+  while ((waitpid(async->pid, NULL, 0) < 0) && (errno == EINTR)) {;}
+  free(async->buffer);
+  async->buffer= NULL;
+}
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  ******************* WATCH ***************
+  After the first trace, keep the answer current with inotify instead of tracing again.
+  Watched: each file in the list that exists (changes to it), the parent directory of each file in the list
+  (so creation, deletion, and replacement-by-rename are seen, which matters for files that were missing),
+  the nearest existing ancestor if a parent directory is missing, and the library and its directory.
+  When something happens to a listed file, stat() it and compare with what was known, then say
+    (pgoptionfiles)(watch)created file-name   or   (pgoptionfiles)(watch)deleted file-name
+    or (pgoptionfiles)(watch)modified file-name
+  With --format json each is {"watch":"created","name":"file-name"} on a line, with --format nul the terminator is '\0'.
+  When the library changes, wait till it's quiet for PGOPTIONFILES_WATCH_QUIET_MS, then trace again and
+  output everything again as after the first trace, preceded by (pgoptionfiles)(watch)retrace library-name.
+  It never ends unless there's an error or a signal.
+*/
+
+#ifndef PGOPTIONFILES_WATCH_QUIET_MS
+#define PGOPTIONFILES_WATCH_QUIET_MS 250
+#endif
+
+#define PGOPTIONFILES_WATCH_FILE_MASK (IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+#define PGOPTIONFILES_WATCH_DIRECTORY_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR)
+
+/* What watch knows about each list entry, what stat() said last time and which watches involve it */
+struct pgoptionfiles_watch_item
+{
+  int file_wd;                    /* -1 if not watched, i.e. file is missing */
+  int directory_wd;               /* parent directory or nearest existing ancestor */
+  int is_directory_missing;       /* 1 if directory_wd is an ancestor, not the parent */
+  size_t missing_name_offset;     /* if is_directory_missing: where in the file name the ancestor's child starts */
+  int is_exists;
+  struct stat st;
+  int is_dirty;                   /* something happened, compare after this batch of events */
+};
+
+struct pgoptionfiles_watch
+{
+  int inotify_fd;
+  struct pgoptionfiles_watch_item *items;
+  unsigned int item_count;
+  int library_wd;
+  int library_directory_wd;
+  char library_base_name[PATH_MAX];
+};
+
+/* Return: 1 if something that matters is different (identity, size, time), 0 if not */
+static int pgoptionfiles_watch_is_changed(const struct stat *a, const struct stat *b)
+{
+  return ((a->st_ino != b->st_ino) || (a->st_dev != b->st_dev) || (a->st_size != b->st_size) || (a->st_mode != b->st_mode)
+       || (a->st_mtim.tv_sec != b->st_mtim.tv_sec) || (a->st_mtim.tv_nsec != b->st_mtim.tv_nsec)
+       || (a->st_ctim.tv_sec != b->st_ctim.tv_sec) || (a->st_ctim.tv_nsec != b->st_ctim.tv_nsec));
+}
+
+/*
+  Pass: path of a file
+  Do: watch its parent directory, or if that doesn't exist the nearest ancestor that does
+  Return: wd or -1, *is_missing= 1 if it's not the parent, *name_offset= where in file_name the watched
+          directory's child starts, i.e. the name that events in it must have to matter
+*/
+static int pgoptionfiles_watch_directory(int inotify_fd, const char *file_name, int *is_missing, size_t *name_offset)
+{
+  char directory_name[PATH_MAX];
+  snprintf(directory_name, sizeof(directory_name), "%s", file_name);
+  *is_missing= 0;
+  for (;;)
+  {
+    char *slash= strrchr(directory_name, '/');
+    if (slash == NULL) strcpy(directory_name, ".");
+    else if (slash == directory_name) directory_name[1]= '\0';
+    else *slash= '\0';
+    int wd= inotify_add_watch(inotify_fd, directory_name, PGOPTIONFILES_WATCH_DIRECTORY_MASK);
+    if (wd >= 0)
+    {
+      if (strcmp(directory_name, ".") == 0) *name_offset= (file_name[0] == '.' && file_name[1] == '/') ? 2 : 0;
+      else if (strcmp(directory_name, "/") == 0) *name_offset= 1;
+      else *name_offset= strlen(directory_name) + 1;
+      return wd;
+    }
+    if ((strcmp(directory_name, "/") == 0) || (strcmp(directory_name, ".") == 0)) return -1;
+    *is_missing= 1;
+  }
+}
+
+/* Do: (re)start inotify with watches for everything in list. Return: 0 ok, -1 error */
+static int pgoptionfiles_watch_start(struct pgoptionfiles_watch *watch, const struct pgoptionfiles_list *list, const char *library_name)
+{
+  if (watch->inotify_fd >= 0) close(watch->inotify_fd);
+  free(watch->items);
+  watch->items= calloc(list->entry_count + 1, sizeof(struct pgoptionfiles_watch_item));
+  watch->item_count= list->entry_count;
+  watch->inotify_fd= inotify_init1(IN_CLOEXEC);
+  if ((watch->inotify_fd < 0) || (watch->items == NULL)) return -1;
+  for (unsigned int i= 0; i < list->entry_count; ++i)
+  {
+    struct pgoptionfiles_watch_item *item= &watch->items[i];
+    const char *file_name= PGOPTIONFILES_LIST_NAME(list, i);
+    item->is_exists= (stat(file_name, &item->st) == 0);
+    item->file_wd= -1;
+    if (item->is_exists) item->file_wd= inotify_add_watch(watch->inotify_fd, file_name, PGOPTIONFILES_WATCH_FILE_MASK);
+    item->directory_wd= pgoptionfiles_watch_directory(watch->inotify_fd, file_name, &item->is_directory_missing, &item->missing_name_offset);
+  }
+  int is_missing;
+  size_t name_offset;
+  watch->library_wd= inotify_add_watch(watch->inotify_fd, library_name, PGOPTIONFILES_WATCH_FILE_MASK | IN_MODIFY);
+  watch->library_directory_wd= pgoptionfiles_watch_directory(watch->inotify_fd, library_name, &is_missing, &name_offset);
+  const char *slash= strrchr(library_name, '/');
+  snprintf(watch->library_base_name, sizeof(watch->library_base_name), "%s", (slash == NULL) ? library_name : slash + 1);
+  return 0;
+}
+
+/* Say what changed, in the --format style */
+static void pgoptionfiles_watch_say(const char *what, const char *file_name, const char *format)
+{
+  char line[PATH_MAX * 2 + 64];
+  int length;
+  if ((format != NULL) && (strcmp(format, "json") == 0))
+  {
+    length= snprintf(line, sizeof(line), "{\"watch\":\"%s\",\"name\":\"", what);
+    for (const char *p= file_name; (*p != '\0') && (length < (int) sizeof(line) - 8); ++p)
+    {
+      unsigned char c= (unsigned char) *p;
+      if ((c == '"') || (c == '\\')) { line[length++]= '\\'; line[length++]= c; }
+      else if (c < 0x20) length+= sprintf(line + length, "\\u%04x", c);
+      else line[length++]= c;
+    }
+    length+= sprintf(line + length, "\"}\n");
+  }
+  else
+  {
+    int is_nul= ((format != NULL) && (strcmp(format, "nul") == 0));
+    length= snprintf(line, sizeof(line) - 1, "(pgoptionfiles)(watch)%s %s", what, file_name);
+    if (length > (int) sizeof(line) - 2) length= sizeof(line) - 2;
+    line[length++]= is_nul ? '\0' : '\n';
+  }
+  if (write(STDOUT_FILENO, line, length) < 0) {;}
+}
+
+/*
+  Pass: list after the first trace, error_list, options
+  Do: what's described at the start of this section
+  Return: only if error, -8
+*/
+int pgoptionfiles_watch(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options)
+{
+  struct pgoptionfiles_watch watch;
+  memset(&watch, 0, sizeof(watch));
+  watch.inotify_fd= -1;
+  if (pgoptionfiles_watch_start(&watch, file_names_list, options->library_name) != 0)
+  {
+    free(watch.items);
+    strcat(error_list, "Error: inotify failed.");
+    printf("%s\n", error_list);
+    return -8;
+  }
+  char buffer[16384] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  for (;;)
+  {
+    int is_library_changed= 0;
+    int is_restart_needed= 0;
+    ssize_t read_result= read(watch.inotify_fd, buffer, sizeof(buffer));
+    if (read_result < 0 && errno == EINTR) continue;
+    if (read_result <= 0) break;
+    for (char *p= buffer; p < buffer + read_result; )
+    {
+      const struct inotify_event *event= (const struct inotify_event *) p;
+      p+= sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) { is_restart_needed= 1; for (unsigned int i= 0; i < watch.item_count; ++i) watch.items[i].is_dirty= 1; continue; }
+      if (event->wd == watch.library_wd) is_library_changed= 1;
+      if ((event->wd == watch.library_directory_wd) && (event->len > 0) && (strcmp(event->name, watch.library_base_name) == 0))
+        is_library_changed= 1;
+      for (unsigned int i= 0; i < watch.item_count; ++i)
+      {
+        struct pgoptionfiles_watch_item *item= &watch.items[i];
+        if (event->wd == item->file_wd) item->is_dirty= 1;
+        if (event->wd != item->directory_wd) continue;
+        const char *file_name= PGOPTIONFILES_LIST_NAME(file_names_list, i);
+        if (item->is_directory_missing)
+        {
+          /*
+            Event in an ancestor of a missing directory. If it's for the name on the way to the file, maybe that
+            directory was made, so watches must change. If the ancestor itself went (IN_IGNORED), move up.
+          */
+          int is_on_path= (event->mask & IN_IGNORED);
+          if (event->len > 0)
+          {
+            const char *child= file_name + item->missing_name_offset;
+            size_t child_length= strcspn(child, "/");
+            is_on_path= ((strlen(event->name) == child_length) && (strncmp(child, event->name, child_length) == 0));
+          }
+          if (is_on_path) { item->is_dirty= 1; is_restart_needed= 1; }
+          continue;
+        }
+        if (event->len == 0) continue;
+        const char *slash= strrchr(file_name, '/');
+        if (strcmp((slash == NULL) ? file_name : slash + 1, event->name) == 0) item->is_dirty= 1;
+      }
+    }
+    if (is_library_changed)
+    {
+      /* A library upgrade can be several writes + renames, so wait till it stops */
+      struct pollfd pfd= {watch.inotify_fd, POLLIN, 0};
+      while (poll(&pfd, 1, PGOPTIONFILES_WATCH_QUIET_MS) > 0)
+        if (read(watch.inotify_fd, buffer, sizeof(buffer)) <= 0) break;
+      pgoptionfiles_watch_say("retrace", options->library_name, options->format);
+      pgoptionfiles_list_free(file_names_list);
+      pgoptionfiles_list_init(file_names_list);
+      strcpy(error_list, "(pgoptionfiles)");
+      int result_code= pgoptionfiles_run(file_names_list, error_list, options);
+      if (options->is_verify == 1) pgoptionfiles_verify(file_names_list, options->root_directory);
+      pgoptionfiles_output(STDOUT_FILENO, file_names_list, error_list, result_code, options->format, options->delimiter);
+      if (pgoptionfiles_watch_start(&watch, file_names_list, options->library_name) != 0) break;
+      continue;
+    }
+    for (unsigned int i= 0; i < watch.item_count; ++i)
+    {
+      struct pgoptionfiles_watch_item *item= &watch.items[i];
+      if (!item->is_dirty) continue;
+      item->is_dirty= 0;
+      const char *file_name= PGOPTIONFILES_LIST_NAME(file_names_list, i);
+      struct stat st;
+      int is_exists= (stat(file_name, &st) == 0);
+      if (is_exists && !item->is_exists) pgoptionfiles_watch_say("created", file_name, options->format);
+      else if (!is_exists && item->is_exists) pgoptionfiles_watch_say("deleted", file_name, options->format);
+      else if (is_exists && pgoptionfiles_watch_is_changed(&st, &item->st)) pgoptionfiles_watch_say("modified", file_name, options->format);
+      else continue;
+      /* The file watch is for an inode, so after create or replace it's for a different inode */
+      if ((item->file_wd >= 0) && (!is_exists || (st.st_ino != item->st.st_ino))) inotify_rm_watch(watch.inotify_fd, item->file_wd);
+      if (is_exists && (!item->is_exists || (st.st_ino != item->st.st_ino)))
+        item->file_wd= inotify_add_watch(watch.inotify_fd, file_name, PGOPTIONFILES_WATCH_FILE_MASK);
+      else if (!is_exists) item->file_wd= -1;
+      item->is_exists= is_exists;
+      item->st= st;
+    }
+    if (is_restart_needed)
+    {
+      /* Restarting means stat() again, so report anything that happened between the events and now */
+      struct pgoptionfiles_watch_item *old_items= watch.items;
+      watch.items= NULL;
+      if (pgoptionfiles_watch_start(&watch, file_names_list, options->library_name) != 0) { free(old_items); break; }
+      for (unsigned int i= 0; i < watch.item_count; ++i)
+      {
+        const char *file_name= PGOPTIONFILES_LIST_NAME(file_names_list, i);
+        if (watch.items[i].is_exists && !old_items[i].is_exists) pgoptionfiles_watch_say("created", file_name, options->format);
+        else if (!watch.items[i].is_exists && old_items[i].is_exists) pgoptionfiles_watch_say("deleted", file_name, options->format);
+      }
+      free(old_items);
+    }
+  }
+  free(watch.items);
+  if (watch.inotify_fd >= 0) close(watch.inotify_fd);
+  strcat(error_list, "Error: inotify read failed.");
+  printf("%s\n", error_list);
+  return -8;
+}
+#endif
@@ -24,6 +24,7 @@
 #ifndef PGOPTIONFILES_H
 #define PGOPTIONFILES_H
 
+/* The defaults for --delimiter and --read, --timeout below */
 #ifndef PGOPTIONFILES_DELIMITER
 #define PGOPTIONFILES_DELIMITER '\n'
 #endif
@@ -32,7 +33,7 @@
 #define PGOPTIONFILES_READ 0
 #endif
 
-/* PATH_MAX is probably 4096. In fact list size is usually < 100 bytes */
+/* PATH_MAX is probably 4096. In fact list size is usually < 100 bytes. This is the limit for the sum of file name lengths. */
 #ifndef PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE
 #define PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE (PATH_MAX * 10)
 #endif
@@ -47,21 +48,125 @@
 #define PGOPTIONFILES_INCLUDE_MYSQL 0
 #endif
 
+/* say 0 to skip posix_fadvise(WILLNEED) of the library and its DT_NEEDED libraries before the tracee's dlopen() */
+#ifndef PGOPTIONFILES_PREFETCH
+#define PGOPTIONFILES_PREFETCH 1
+#endif
+#define PGOPTIONFILES_PREFETCH_MAX_FILES 256
+
+/* --scan: at most this many workers at once, or the number of CPUs if that's less */
+#ifndef PGOPTIONFILES_MAX_WORKERS
+#define PGOPTIONFILES_MAX_WORKERS 16
+#endif
+
+/* --compare-placement: timed runs per placement, after one untimed run */
+#ifndef PGOPTIONFILES_COMPARE_RUNS
+#define PGOPTIONFILES_COMPARE_RUNS 20
+#endif
+
+/* --coalesce: where the lock and result files are */
+#ifndef PGOPTIONFILES_COALESCE_DIRECTORY
+#define PGOPTIONFILES_COALESCE_DIRECTORY "/tmp"
+#endif
+
+/* --pid: stop this long after the latest option file, or after this many seconds if there's none */
+#ifndef PGOPTIONFILES_ATTACH_QUIET_MILLISECONDS
+#define PGOPTIONFILES_ATTACH_QUIET_MILLISECONDS 500
+#endif
+#ifndef PGOPTIONFILES_ATTACH_SECONDS
+#define PGOPTIONFILES_ATTACH_SECONDS 60
+#endif
+
+/* say 0 to leave out the USDT probes, by default they're in if there's <sys/sdt.h> (systemtap-sdt-dev) */
+#ifndef PGOPTIONFILES_USDT
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define PGOPTIONFILES_USDT 1
+#endif
+#endif
+#endif
+#ifndef PGOPTIONFILES_USDT
+#define PGOPTIONFILES_USDT 0
+#endif
+
 /* say 1 to eliminate the tracer, this is a debugging option */
 #ifndef PGOPTIONFILES_TRACEE_ONLY
 #define PGOPTIONFILES_TRACEE_ONLY 0
 #endif
 
-#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/* say 1 to leave out main(), for linking pgoptionfiles.c into another program */
+#ifndef PGOPTIONFILES_LIBRARY
+#define PGOPTIONFILES_LIBRARY 0
+#endif
+
+/* say 1 to build pgoptionfiles_tracee, the program that the tracer runs as the tracee if it's in the same directory */
+#ifndef PGOPTIONFILES_TRACEE_PROGRAM
+#define PGOPTIONFILES_TRACEE_PROGRAM 0
+#endif
+#define PGOPTIONFILES_TRACEE_PROGRAM_NAME "pgoptionfiles_tracee"
+#define PGOPTIONFILES_PROGRAM_NAME "pgoptionfiles" /* what pgoptionfiles_async_start() runs, from the caller's directory */
+#if (PGOPTIONFILES_TRACEE_PROGRAM == 1) /* there's no tracer in it, but its messages go to a tracer */
+#undef PGOPTIONFILES_TRACEE_ONLY
+#define PGOPTIONFILES_TRACEE_ONLY 1
+#endif
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) || (PGOPTIONFILES_TRACEE_PROGRAM == 1)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE      /* nftw() FTW_PHYS for --scan, unshare() for --root */
+#endif
 #include <sys/ptrace.h>   /* This defines some PTRACE_ items as enum */
 //#include <linux/ptrace.h> /* This defines same PTRACE_ items as int, that's why there are casts to enum */
 #include <sys/user.h>
 #include <sys/wait.h>
-#include <errno.h>
 #include <stdint.h>
 //#include <sys/types.h>
 #include <sys/syscall.h> /* This should have SYS_lstat etc. */
+#include <stddef.h>      /* offsetof() for PTRACE_PEEKUSER */
+#include <time.h>        /* clock_gettime() for --record timestamps */
+#include <sys/uio.h>     /* writev() for output */
+#include <sys/inotify.h> /* --watch */
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/prctl.h>   /* --backend seccomp */
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/seccomp.h>
+#include <linux/filter.h>
+#include <linux/audit.h>
+#include <sys/mman.h>    /* prefetch */
+#include <link.h>        /* ElfW(), dl_iterate_phdr() */
+#include <elf.h>
+#include <ftw.h>         /* --scan */
+#include <sched.h>       /* --root unshare(), --placement, --sched */
+#include <sys/mount.h>
+#include <pwd.h>
+#include <netinet/in.h>  /* --profile connect() addresses */
+#include <arpa/inet.h>
+#include <sys/un.h>
+#include <linux/io_uring.h> /* --verify */
+#include <linux/openat2.h> /* --verify --root, RESOLVE_IN_ROOT */
+#include <spawn.h>       /* posix_spawn() of pgoptionfiles_tracee */
+#include <pthread.h>     /* pthread_create() for prefetch */
+#include <dirent.h>      /* --pid /proc/PID/task */
+#include <signal.h>
+#include <sys/time.h>    /* --pid setitimer() */
+#include <stdarg.h>      /* --backend dlmopen open() stub */
+#include <linux/perf_event.h> /* --perf-counters */
+#include <sys/file.h>    /* --coalesce flock() */
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 34)))
+#define PGOPTIONFILES_SPAWN_CLOSEFROM /* posix_spawn_file_actions_addclosefrom_np() for pgoptionfiles_tracee */
+#endif
 #endif
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) && (PGOPTIONFILES_USDT == 1)
+#include <sys/sdt.h>     /* USDT probes */
+#define PGOPTIONFILES_PROBE2(name, arg1, arg2) STAP_PROBE2(pgoptionfiles, name, arg1, arg2)
+#define PGOPTIONFILES_PROBE3(name, arg1, arg2, arg3) STAP_PROBE3(pgoptionfiles, name, arg1, arg2, arg3)
+#else
+#define PGOPTIONFILES_PROBE2(name, arg1, arg2) do {} while (0)
+#define PGOPTIONFILES_PROBE3(name, arg1, arg2, arg3) do {} while (0)
+#endif
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -69,11 +174,320 @@
 #include <dlfcn.h>
 #include <limits.h>
 
-void pgoptionfiles_tracee(const char *);
-int pgoptionfiles_tracer(pid_t pid, char *file_names_list, char *error_list);
+#ifdef __cplusplus
+extern "C" {              /* e.g. ocelotgui, which is C++, links pgoptionfiles.c in with PGOPTIONFILES_LIBRARY */
+#endif
+
+/* --query GROUP[,FILE], i.e. mysql_options(MYSQL_READ_DEFAULT_GROUP, group) and maybe (MYSQL_READ_DEFAULT_FILE, file) */
+#define PGOPTIONFILES_MAX_QUERIES 16
+#define PGOPTIONFILES_QUERY_LABEL_SIZE 256
+struct pgoptionfiles_query
+{
+  const char *group;
+  const char *file;               /* NULL if no ,FILE */
+};
+
+/* What the user asked for on the command line. Anything not specified is 0 or NULL, or the build's default. */
+struct pgoptionfiles_options
+{
+  const char *library_name;       /* the Connector C library, i.e. the argument that doesn't start with -- */
+  const char *record_file_name;   /* --record FILE */
+  const char *replay_file_name;   /* --replay FILE */
+  int is_diff;                    /* --diff */
+  const char *library_name_2;     /* the second library-file if --diff */
+  const char *metrics_format;     /* --metrics json or --metrics prometheus */
+  const char *format;             /* --format newline|nul|json|csv|stream, default newline */
+  int is_watch;                   /* --watch */
+  int is_seccomp;                 /* --backend seccomp, default is --backend ptrace */
+  int is_dlmopen;                 /* --backend dlmopen */
+  struct pgoptionfiles_query queries[PGOPTIONFILES_MAX_QUERIES]; /* --query, if query_count == 0 it's as if --query client */
+  int query_count;
+  const char *scan_directories;   /* --scan DIRS, colon-separated */
+  const char *root_directories;   /* --root DIR or DIR:DIR... */
+  const char *root_directory;     /* the one DIR that this tracee will chroot to, or NULL */
+  int is_profile;                 /* --profile */
+  int is_verify;                  /* --verify */
+  pid_t attach_pid;               /* --pid PID, instead of library_name */
+  int is_read;                    /* --read or --no-read, default PGOPTIONFILES_READ */
+  int is_timeout;                 /* --timeout or --no-timeout, default PGOPTIONFILES_USE_TIMEOUT */
+  char delimiter;                 /* --delimiter C, default PGOPTIONFILES_DELIMITER */
+  int is_tracee_only;             /* --tracee-only, always if PGOPTIONFILES_TRACEE_ONLY */
+  int is_perf_counters;           /* --perf-counters */
+  const char *placement;          /* --placement same|siblings|spread[,CPU], NULL or "none" = leave CPUs alone */
+  const char *sched;              /* --sched other|batch|idle|fifo|rr, NULL = leave the policy alone */
+  int is_compare_placement;       /* --compare-placement */
+  int is_coalesce;                /* --coalesce */
+  struct pgoptionfiles_metrics *metrics_result; /* if not NULL, pgoptionfiles_tracer_finish() copies the metrics here */
+};
+
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+/*
+  Tracee phases. "load" is dlopen() + dlsym() + mysql_init(), it ends with the "(Connector C version ...)" message.
+  The others end with a "(Connector phase ..." message, or for "close" with the end of the trace.
+*/
+#define PGOPTIONFILES_PHASE_LOAD 0
+#define PGOPTIONFILES_PHASE_OPTIONS 1
+#define PGOPTIONFILES_PHASE_CONNECT 2
+#define PGOPTIONFILES_PHASE_CLOSE 3
+#define PGOPTIONFILES_PHASE_COUNT 4
+extern const char *pgoptionfiles_phase_names[PGOPTIONFILES_PHASE_COUNT];
+
+/* What --metrics reports. Times are nanoseconds. */
+struct pgoptionfiles_metrics
+{
+  unsigned long long syscall_stops;       /* entry + exit */
+  unsigned long long classified_stops;    /* entry with relevant syscall number and a file name */
+  unsigned long long peekdata_calls;      /* each call copies sizeof(size_t) bytes */
+  unsigned long long dedup_hits;
+  unsigned long long file_names;
+  unsigned long long directory_lookups;   /* pgoptionfiles_canonical() readlink()s, i.e. fd cache misses */
+  int64_t waitpid_nanoseconds;
+  int64_t load_waitpid_nanoseconds;       /* the part of waitpid_nanoseconds that was in the load phase */
+  int64_t trace_nanoseconds;
+  int64_t phase_nanoseconds[PGOPTIONFILES_PHASE_COUNT];
+};
+
+/*
+  --profile. Syscall numbers >= PGOPTIONFILES_PROFILE_MAX_SYSCALL are counted in the last slot as "other".
+  entry_... is the syscall in progress, between entry stop and exit stop.
+*/
+#define PGOPTIONFILES_PROFILE_MAX_SYSCALL 512
+#define PGOPTIONFILES_PROFILE_SLOWEST 10
+struct pgoptionfiles_profile_slow
+{
+  int64_t nanoseconds;
+  size_t syscall_number;
+  int phase;
+  char detail[PATH_MAX];          /* file name, or address for connect(), or "" */
+};
+struct pgoptionfiles_profile
+{
+  unsigned long long counts[PGOPTIONFILES_PHASE_COUNT][PGOPTIONFILES_PROFILE_MAX_SYSCALL];
+  int64_t nanoseconds[PGOPTIONFILES_PHASE_COUNT][PGOPTIONFILES_PROFILE_MAX_SYSCALL];
+  struct pgoptionfiles_profile_slow slowest[PGOPTIONFILES_PROFILE_SLOWEST]; /* slowest first */
+  int64_t entry_nanoseconds;
+  size_t entry_syscall_number;
+  int entry_phase;
+  int is_entry_pending;           /* 1 between entry stop and exit stop */
+  char entry_detail[PATH_MAX];
+};
+
+/* One file name in the list, i.e. the first time the tracee passed it to a relevant syscall */
+struct pgoptionfiles_entry
+{
+  unsigned int name_offset;       /* in pgoptionfiles_list names */
+  unsigned int name_length;
+  long syscall_result;            /* 0 or positive = success, negative = -errno, -ENOSYS = syscall exit not seen */
+  int is_denied;                  /* 1 if PGOPTIONFILES_READ == 0 so the tracer made the syscall fail */
+  unsigned int query_number;      /* 0 if no --query, else which query_labels[] it belongs to */
+  int stat_errno;                 /* --verify: 0 if statx() found it, else errno */
+  long long size;                 /* --verify: if found */
+  long long mtime;                /* --verify: if found, seconds since the epoch */
+  int directory_errno;            /* --verify: 0 if its directory exists, else errno */
+};
+
+/*
+  The file names list. names is "file-name\0file-name\0..." in order of first appearance.
+  hash_table has entry number + 1 (0 = empty slot), it's for finding duplicates.
+  Everything is malloc'd and grows, up to PGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE bytes of names.
+  If --query: query_labels[] are "group" or "group,file" in order, and a file name is a duplicate only if
+  it's already in the list for the same query. New entries get the current query_number, i.e. query_count - 1.
+*/
+struct pgoptionfiles_list
+{
+  char *names;
+  size_t names_size;
+  size_t names_allocated;
+  struct pgoptionfiles_entry *entries;
+  unsigned int entry_count;
+  unsigned int entries_allocated;
+  unsigned int *hash_table;
+  unsigned int hash_table_size;   /* 0 or a power of 2 */
+  unsigned int query_count;       /* 0 if no --query */
+  unsigned int query_number;
+  char query_labels[PGOPTIONFILES_MAX_QUERIES][PGOPTIONFILES_QUERY_LABEL_SIZE];
+  int is_verified;                /* 1 if pgoptionfiles_verify() filled in the entries' --verify items */
+  int stream_fd;                  /* -1, or where pgoptionfiles_list_stream() writes entries as they're complete */
+  unsigned int stream_count;      /* how many entries pgoptionfiles_list_stream() has written */
+};
+#define PGOPTIONFILES_LIST_NAME(list, entry_number) ((list)->names + (list)->entries[(entry_number)].name_offset)
+
+/*
+  --perf-counters. Per process, a group leader fd + member fds, and where each event is in the group's read()
+  (-1 if it couldn't be opened). last[] is the latest read, counts[] are the differences per phase.
+*/
+#define PGOPTIONFILES_PERF_EVENTS 6
+#define PGOPTIONFILES_PERF_TRACER 0
+#define PGOPTIONFILES_PERF_TRACEE 1
+#define PGOPTIONFILES_PERF_PROCESSES 2
+struct pgoptionfiles_perf
+{
+  int leader_fds[PGOPTIONFILES_PERF_PROCESSES];
+  int member_fds[PGOPTIONFILES_PERF_PROCESSES][PGOPTIONFILES_PERF_EVENTS];
+  int member_count[PGOPTIONFILES_PERF_PROCESSES];
+  int event_count[PGOPTIONFILES_PERF_PROCESSES];
+  int positions[PGOPTIONFILES_PERF_PROCESSES][PGOPTIONFILES_PERF_EVENTS];
+  int is_user_only[PGOPTIONFILES_PERF_PROCESSES][PGOPTIONFILES_PERF_EVENTS];
+  unsigned long long last[PGOPTIONFILES_PERF_PROCESSES][PGOPTIONFILES_PERF_EVENTS];
+  unsigned long long counts[PGOPTIONFILES_PERF_PROCESSES][PGOPTIONFILES_PHASE_COUNT][PGOPTIONFILES_PERF_EVENTS];
+};
+
+/* Directory names of a tracee's fds, AT_FDCWD = its current directory. See the CANONICAL PATHS section. */
+#define PGOPTIONFILES_FD_CACHE_SIZE 16
+struct pgoptionfiles_fd_cache
+{
+  unsigned int count;
+  unsigned int next;              /* which one to replace when it's full */
+  int fds[PGOPTIONFILES_FD_CACHE_SIZE];
+  char directory_names[PGOPTIONFILES_FD_CACHE_SIZE][PATH_MAX];
+};
+
+/*
+  --placement and --sched. What pgoptionfiles_placement_start() chose, and what to put back afterwards.
+  tracer_cpu and tracee_cpu are -1 if not pinned. See the PLACEMENT section.
+*/
+struct pgoptionfiles_placement
+{
+  int tracer_cpu;
+  int tracee_cpu;
+  int is_affinity_saved;
+  cpu_set_t saved_cpus;
+  int is_policy_saved;
+  int saved_policy;
+  struct sched_param saved_param;
+};
+
+/* What the tracer knows so far. pgoptionfiles_tracer() and pgoptionfiles_replay() both fill it in. */
+struct pgoptionfiles_state
+{
+  const struct pgoptionfiles_options *options;
+  struct pgoptionfiles_list *file_names_list;
+  int last_entry_number;          /* >= 0 if the latest classified stop added an entry, so syscall exit can fill it in */
+  char *error_list;
+  int retcode;
+  int is_connector_message_seen;
+  FILE *record_file;              /* not NULL if --record */
+  struct timespec start_time;     /* so --record timestamps are relative to start of trace */
+  int64_t timestamp;              /* nanoseconds since start_time, of the latest classified stop, if --metrics or --record */
+  int phase;                      /* PGOPTIONFILES_PHASE_... */
+  int64_t phase_start;
+  struct pgoptionfiles_metrics metrics;
+  struct pgoptionfiles_profile *profile; /* NULL unless --profile */
+  struct pgoptionfiles_fd_cache *fd_cache; /* NULL unless the backend sees every close() etc. */
+  struct pgoptionfiles_perf *perf;        /* NULL unless --perf-counters */
+};
+
+/*
+  --record file format: PGOPTIONFILES_RECORD_MAGIC, then for each classified syscall stop a
+  struct pgoptionfiles_record followed by file_name_length bytes of file name (no '\0').
+  Integers are in host byte order, the file is meant for replay on the same kind of machine.
+*/
+#define PGOPTIONFILES_RECORD_MAGIC "pgofrec1"
+struct pgoptionfiles_record
+{
+  int32_t syscall_number;
+  uint32_t file_name_length;
+  int64_t syscall_result;         /* return value, or -ENOSYS if tracing ended before syscall exit */
+  int64_t timestamp;              /* nanoseconds since start of trace */
+};
+
+/* pgoptionfiles_async_start() etc., see the ASYNC section. status is as for output, e.g. "not found (denied)". */
+typedef void (*pgoptionfiles_async_file_callback)(void *user_data, const char *file_name, const char *status, const char *query_label);
+typedef void (*pgoptionfiles_async_done_callback)(void *user_data, int result_code, const char *error_list);
+struct pgoptionfiles_async
+{
+  pid_t pid;                      /* the worker */
+  int fd;                         /* -1 when finished */
+  char *buffer;                   /* what's been read but not yet passed to a callback */
+  size_t buffer_size;
+  size_t buffer_used;
+  char query_label[PGOPTIONFILES_QUERY_LABEL_SIZE];
+  pgoptionfiles_async_file_callback file_callback;
+  pgoptionfiles_async_done_callback done_callback;
+  void *user_data;
+};
+
+/* pgoptionfiles_tracer_file_name() return values */
+#define PGOPTIONFILES_FILE_NAME_IGNORE 0
+#define PGOPTIONFILES_FILE_NAME_OPTION_FILE 1
+#define PGOPTIONFILES_FILE_NAME_STOP 2
+#endif
+
+int pgoptionfiles_options_parse(int argc, char **argv, struct pgoptionfiles_options *options, char *error_list);
+void pgoptionfiles_tracee(const struct pgoptionfiles_options *options, int sync_fd);
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+int pgoptionfiles_tracer(pid_t pid, int sync_fd, struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_replay(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_run_ptrace(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+pid_t pgoptionfiles_tracee_spawn(const struct pgoptionfiles_options *options, int sync_fd, int tracer_sync_fd);
+#endif
+#if (PGOPTIONFILES_TRACEE_ONLY == 0) || (PGOPTIONFILES_TRACEE_PROGRAM == 1)
+const char *pgoptionfiles_root_enter(const char *root_directory);
+#endif
 int pgoptionfiles_copy_from_tracee(pid_t tracee_pid, char *dest, const char *src);
 void pgoptionfiles_tracee_error_or_message(const char *);
+extern int pgoptionfiles_is_tracee_printing;
 int pgoptionfiles_tracer_arg_number(size_t psi_entry_nr);
+#if (PGOPTIONFILES_TRACEE_ONLY == 0)
+int pgoptionfiles_tracer_file_name(struct pgoptionfiles_state *state, const char *file_name);
+int pgoptionfiles_canonical(struct pgoptionfiles_state *state, pid_t pid, int directory_fd, const char *file_name, char *canonical_name);
+void pgoptionfiles_fd_cache_syscall(struct pgoptionfiles_state *state, size_t syscall_number, long arg0, long arg1);
+void pgoptionfiles_tracer_finish(struct pgoptionfiles_state *state);
+void pgoptionfiles_tracer_phase(struct pgoptionfiles_state *state, int phase);
+int64_t pgoptionfiles_nanoseconds_since(const struct timespec *start);
+void pgoptionfiles_metrics_print(const struct pgoptionfiles_state *state, FILE *fp);
+int pgoptionfiles_verify(struct pgoptionfiles_list *list, const char *root_directory);
+void pgoptionfiles_list_init(struct pgoptionfiles_list *list);
+void pgoptionfiles_list_stream(struct pgoptionfiles_list *list, const char *query_label);
+void pgoptionfiles_list_free(struct pgoptionfiles_list *list);
+int pgoptionfiles_list_find(const struct pgoptionfiles_list *list, const char *file_name, size_t file_name_length);
+int pgoptionfiles_list_add(struct pgoptionfiles_list *list, const char *file_name, size_t file_name_length);
+int pgoptionfiles_output(int fd, const struct pgoptionfiles_list *file_names_list, const char *error_list, int retcode, const char *format,
+                         char delimiter_character);
+const char *pgoptionfiles_entry_status(const struct pgoptionfiles_entry *entry);
+pid_t pgoptionfiles_worker_start(const struct pgoptionfiles_options *options, int *read_fd);
+int pgoptionfiles_worker_finish(pid_t pid, int read_fd, struct pgoptionfiles_list *file_names_list, char *error_list, size_t error_list_size);
+void pgoptionfiles_worker_write(FILE *fp, const struct pgoptionfiles_list *file_names_list, const char *error_list);
+int pgoptionfiles_worker_parse(const char *buffer, size_t buffer_length, struct pgoptionfiles_list *file_names_list, char *error_list, size_t error_list_size);
+int pgoptionfiles_coalesce(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_worker_pool(const struct pgoptionfiles_options *job_options, const char **job_labels, int job_count);
+int pgoptionfiles_diff(const struct pgoptionfiles_options *options);
+int pgoptionfiles_async_start(struct pgoptionfiles_async *async, const struct pgoptionfiles_options *options,
+                              pgoptionfiles_async_file_callback file_callback, pgoptionfiles_async_done_callback done_callback,
+                              void *user_data);
+int pgoptionfiles_async_pump(struct pgoptionfiles_async *async);
+int pgoptionfiles_stream(const struct pgoptionfiles_options *options, int fd);
+void pgoptionfiles_async_cancel(struct pgoptionfiles_async *async);
+int pgoptionfiles_record_open(struct pgoptionfiles_state *state);
+void pgoptionfiles_record_write(struct pgoptionfiles_state *state, const struct pgoptionfiles_record *record, const char *file_name);
+void pgoptionfiles_record_close(struct pgoptionfiles_state *state);
+void pgoptionfiles_profile_entry(struct pgoptionfiles_state *state, pid_t pid, size_t syscall_number, const struct user_regs_struct *registers);
+void pgoptionfiles_profile_exit(struct pgoptionfiles_state *state);
+void pgoptionfiles_profile_print(const struct pgoptionfiles_state *state, FILE *fp);
+void pgoptionfiles_perf_open(struct pgoptionfiles_state *state, pid_t tracee_pid);
+void pgoptionfiles_perf_phase(struct pgoptionfiles_state *state);
+void pgoptionfiles_perf_print(struct pgoptionfiles_state *state, FILE *fp);
+void pgoptionfiles_perf_close(struct pgoptionfiles_state *state);
+int pgoptionfiles_placement_start(const struct pgoptionfiles_options *options, char *error_list);
+void pgoptionfiles_placement_tracee(pid_t tracee_pid);
+void pgoptionfiles_placement_end(void);
+int pgoptionfiles_compare_placement(const struct pgoptionfiles_options *options);
+int pgoptionfiles_prefetch(const char *library_name);
+int pgoptionfiles_prefetch_start(const char *library_name, pthread_t *thread);
+int pgoptionfiles_seccomp_tracee_start(int socket_fd);
+int pgoptionfiles_dlmopen_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_attach(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_seccomp_run(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_scan(const struct pgoptionfiles_options *options);
+int pgoptionfiles_roots(const struct pgoptionfiles_options *options);
+int pgoptionfiles_watch(struct pgoptionfiles_list *file_names_list, char *error_list, const struct pgoptionfiles_options *options);
+int pgoptionfiles_diff_print(const struct pgoptionfiles_list *a, const struct pgoptionfiles_list *b);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
 
 #if (PGOPTIONFILES_INCLUDE_MYSQL == 1)
 #include <mysql.h>
@@ -82,6 +496,7 @@ typedef struct MYSQL {
   char opaque_item[4096]; /* at time of writing sizeof("real mysql struct") == 1272 */
 } MYSQL;
 enum mysql_option {
+  MYSQL_READ_DEFAULT_FILE = 4,
   MYSQL_READ_DEFAULT_GROUP = 5
 };
 #endif
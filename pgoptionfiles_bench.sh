@@ -0,0 +1,96 @@
+#!/bin/sh
+#
+# pgoptionfiles_bench.sh -- build pgoptionfiles, pgoptionfiles_tracee and libmockmysqlclient.so, then time pgoptionfiles at several scales
+#
+# Copyright (c) 2025 by Peter Gulutzan. All rights reserved.
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 of the License.
+#
+# Usage: sh pgoptionfiles_bench.sh [scale ...]
+#   Default scales are 1 10 100 1000 4000. Environment: RUNS (default 20), BUILD_DIR (default a temporary directory),
+#   CC (default gcc), CFLAGS (default -O2).
+# pgoptionfiles_tracee is built next to pgoptionfiles so the timings are with the posix_spawn() tracee.
+# TRACEE=0 leaves it out, to time the fork() tracee instead.
+# For each scale there are two measurements:
+#   missing  The default build (PGOPTIONFILES_READ=0) with PGOPTIONFILES_MOCK_FILES=scale,
+#            i.e. the mock looks for scale option files that don't exist.
+#   read     A -DPGOPTIONFILES_READ=1 build with PGOPTIONFILES_MOCK_ROOT=corpus, where corpus/my.cnf starts a chain of
+#            8 nested !includedir directories with scale .cnf files in total. This is the thousands-of-entries case.
+# Output is one line per measurement: scale, mode, runs, number of files that pgoptionfiles listed, milliseconds per run.
+# The number of files listed should be scale + 2 for missing (/etc/my.cnf + /etc/mysql/my.cnf ... but that depends
+# on the host) and corpus files + 1 for read, if not it's a bug or the file names list overflowed.
+
+set -e
+
+SCRIPT_DIR=$(cd "$(dirname "$0")" && pwd)
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:--O2}
+RUNS=${RUNS:-20}
+SCALES=${*:-"1 10 100 1000 4000"}
+if [ -z "$BUILD_DIR" ]; then
+  BUILD_DIR=$(mktemp -d)
+  trap 'rm -rf "$BUILD_DIR"' EXIT
+fi
+mkdir -p "$BUILD_DIR"
+
+$CC $CFLAGS -shared -fPIC -o "$BUILD_DIR/libmockmysqlclient.so" "$SCRIPT_DIR/mockmysqlclient.c"
+$CC $CFLAGS -o "$BUILD_DIR/pgoptionfiles" "$SCRIPT_DIR/pgoptionfiles.c" -ldl -lpthread
+if [ "${TRACEE:-1}" = 1 ]; then
+  $CC $CFLAGS -DPGOPTIONFILES_TRACEE_PROGRAM=1 -o "$BUILD_DIR/pgoptionfiles_tracee" "$SCRIPT_DIR/pgoptionfiles.c" -ldl
+else
+  rm -f "$BUILD_DIR/pgoptionfiles_tracee"
+fi
+$CC $CFLAGS -DPGOPTIONFILES_READ=1 -DPGOPTIONFILES_MAX_FILE_NAMES_LIST_SIZE=1048576 \
+  -o "$BUILD_DIR/pgoptionfiles_read" "$SCRIPT_DIR/pgoptionfiles.c" -ldl -lpthread
+
+# Corpus for one scale: 8 levels, each level is a directory of .cnf files, the first file in a level includes the next
+make_corpus()
+{
+  root=$1
+  scale=$2
+  levels=8
+  per_level=$(( (scale + levels - 1) / levels ))
+  rm -rf "$root"
+  mkdir -p "$root"
+  echo "!includedir $root/1" > "$root/my.cnf"
+  made=0
+  level=1
+  directory=$root/1
+  while [ $level -le $levels ] && [ $made -lt "$scale" ]; do
+    mkdir -p "$directory"
+    i=0
+    while [ $i -lt $per_level ] && [ $made -lt "$scale" ]; do
+      file=$(printf '%s/%06d.cnf' "$directory" $i)
+      echo "[client]" > "$file"
+      if [ $i -eq 0 ] && [ $level -lt $levels ]; then echo "!includedir $directory/$((level + 1))" >> "$file"; fi
+      i=$((i + 1))
+      made=$((made + 1))
+    done
+    level=$((level + 1))
+    directory=$directory/$level
+  done
+}
+
+# Run "$@" RUNS times, print number of files listed and milliseconds per run
+time_runs()
+{
+  files=$("$@" | tail -n +2 | grep -c . || true)
+  start=$(date +%s%N)
+  run=0
+  while [ $run -lt "$RUNS" ]; do
+    "$@" > /dev/null
+    run=$((run + 1))
+  done
+  end=$(date +%s%N)
+  echo "$files $(( (end - start) / RUNS / 1000 ))"
+}
+
+printf '%-8s %-8s %-6s %-8s %s\n' scale mode runs files ms_per_run
+for scale in $SCALES; do
+  set -- $(PGOPTIONFILES_MOCK_FILES=$scale time_runs "$BUILD_DIR/pgoptionfiles" "$BUILD_DIR/libmockmysqlclient.so")
+  printf '%-8s %-8s %-6s %-8s %d.%03d\n' "$scale" missing "$RUNS" "$1" $(($2 / 1000)) $(($2 % 1000))
+  make_corpus "$BUILD_DIR/corpus" "$scale"
+  set -- $(PGOPTIONFILES_MOCK_ROOT=$BUILD_DIR/corpus time_runs "$BUILD_DIR/pgoptionfiles_read" "$BUILD_DIR/libmockmysqlclient.so")
+  printf '%-8s %-8s %-6s %-8s %d.%03d\n' "$scale" read "$RUNS" "$1" $(($2 / 1000)) $(($2 % 1000))
+done